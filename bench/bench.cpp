@@ -0,0 +1,660 @@
+#include "suffix_tree.hpp"
+#include "suffix_array.hpp"
+#include "external_nf.hpp"
+#include "lazy_suffix_tree.hpp"
+#include "compressed_suffix_tree.hpp"
+#include "r_index.hpp"
+#include "fm_index.hpp"
+#include "enhanced_suffix_array.hpp"
+#include "succinct_suffix_tree.hpp"
+#include "parallel.hpp"
+#include "memory.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <malloc.h> // mallinfo2
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap
+#include <unistd.h> // ftruncate, pwrite
+
+
+// a random text over the first `sigma` lowercase letters, enclosed by the usual terminators
+static std::string random_text(uint32_t n, uint32_t sigma, std::mt19937& rng) {
+    std::string txt(n + 2, '#');
+    std::uniform_int_distribution<uint32_t> dist(0, sigma - 1);
+    for (uint32_t i = 1; i <= n; i++) txt[i] = (char)('a' + dist(rng));
+    txt[n + 1] = '$';
+    return txt;
+}
+
+template <typename F>
+static double seconds(F f) {
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// run f with std::cout discarded (all_nf prints every string of positive NF)
+template <typename F>
+static double quiet_seconds(F f) {
+    std::ostringstream sink;
+    auto old = std::cout.rdbuf(sink.rdbuf());
+    auto time = seconds(f);
+    std::cout.rdbuf(old);
+    return time;
+}
+
+// the number of bytes currently allocated on the heap (large blocks are mapped separately by malloc)
+static size_t heap_bytes() {
+    auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+static std::vector<std::string> random_patterns(const std::string& txt, uint32_t count, uint32_t len, std::mt19937& rng) {
+    std::vector<std::string> patterns;
+    std::uniform_int_distribution<uint32_t> pos(1, (uint32_t)txt.size() - len - 1);
+    for (uint32_t p = 0; p < count; p++) patterns.push_back(txt.substr(pos(rng), len));
+    return patterns;
+}
+
+
+// ==========================================================================================
+//                 dynamic edits: repairing the tree vs rebuilding it from scratch
+// ==========================================================================================
+
+static void bench_edits(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = random_text(n, 4, rng);
+    auto before = heap_bytes();
+    size_t plain;
+    {
+        SuffixTree fresh{txt, SuffixTree::Options::for_single_nf()};
+        plain = heap_bytes() - before;
+    }
+    before = heap_bytes();
+    SuffixTree st{txt, SuffixTree::Options::for_edits()};
+    auto editable = heap_bytes() - before;
+
+    std::cout << "text length " << txt.size() << ", tree " << (double)plain / (1 << 20) << " MB, editable tree "
+              << (double)editable / (1 << 20) << " MB (edit window " << SuffixTree::Options{}.edit_window << ")\n"
+              << std::setw(8) << "batch" << std::setw(12) << "region"
+              << std::setw(14) << "repair (s)" << std::setw(14) << "rebuild (s)" << '\n';
+
+    // edits anywhere in the text (mostly before the edit window, so the tree is rebuilt in place),
+    // and edits restricted to its last 1% (within the window up to 6.5M characters, so repaired)
+    for (double region : {1.0, 0.01}) {
+        for (uint32_t batch : {1u, 10u, 100u, 1000u}) {
+            auto size = (uint32_t)st.text().size();
+            auto lo = 1 + (uint32_t)((size - 2) * (1.0 - region));
+            std::uniform_int_distribution<uint32_t> pos(lo, size - 3);
+            std::uniform_int_distribution<uint32_t> type(0, 2);
+            std::vector<SuffixTree::Edit> edits;
+            for (uint32_t e = 0; e < batch; e++) {
+                // (insertions and deletions come in pairs to keep the positions valid)
+                auto t = (SuffixTree::Edit::Type)type(rng);
+                edits.push_back({t, pos(rng), (char)('a' + rng() % 4)});
+                if (t == SuffixTree::Edit::Type::insert) {
+                    edits.push_back({SuffixTree::Edit::Type::erase, pos(rng), '\0'});
+                }
+                else if (t == SuffixTree::Edit::Type::erase) {
+                    edits.push_back({SuffixTree::Edit::Type::insert, pos(rng), (char)('a' + rng() % 4)});
+                }
+            }
+
+            auto repair = seconds([&] { st.apply_edits(edits); });
+            std::string edited{st.text()};
+            auto rebuild = seconds([&] { SuffixTree fresh{edited}; });
+
+            std::cout << std::setw(8) << batch << std::setw(11) << region * 100 << '%'
+                      << std::setw(14) << repair << std::setw(14) << rebuild << '\n';
+        }
+    }
+}
+
+
+// ==========================================================================================
+//                  construction: Ukkonen's algorithm vs the parallel top-down builder
+// ==========================================================================================
+
+static void bench_build(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = random_text(n, 4, rng);
+
+    std::cout << "text length " << txt.size() << '\n';
+    std::cout << std::setw(24) << "ukkonen" << std::setw(14) << seconds([&] { SuffixTree st{txt}; }) << '\n';
+    // the profiles: the construction time, the heap size of the tree, an all_nf job and the teardown
+    for (auto [name, options] : {std::pair{"single_nf profile", SuffixTree::Options::for_single_nf()},
+                                 std::pair{"all_nf profile", SuffixTree::Options::for_all_nf()},
+                                 std::pair{"edits profile", SuffixTree::Options::for_edits()}}) {
+        auto before = heap_bytes();
+        std::unique_ptr<SuffixTree> st;
+        auto time = seconds([&] { st = std::make_unique<SuffixTree>(txt, options); });
+        auto mb = (double)(heap_bytes() - before) / (1 << 20);
+        auto job = time + quiet_seconds([&] { st->all_nf(); });
+        auto teardown = seconds([&] { st.reset(); });
+        std::cout << std::setw(24) << name << std::setw(14) << time << std::setw(10) << mb << " MB"
+                  << std::setw(14) << job << " with all_nf" << std::setw(14) << teardown << " teardown\n";
+    }
+    for (unsigned threads = 1; threads <= resolve_threads(0); threads *= 2) {
+        auto time = seconds([&] { SuffixTree st{txt, SuffixTree::Parallel{threads, 4}}; });
+        std::cout << std::setw(16) << "parallel, " << std::setw(2) << threads << " threads"
+                  << std::setw(14) << time << '\n';
+    }
+}
+
+// many small trees, one per document: a new tree for each vs one tree reset to each
+static void bench_reset(uint32_t n) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> len(50, 500);
+    std::vector<std::string> documents;
+    for (uint32_t total = 0; total < n;) {
+        documents.push_back(random_text(len(rng), 4, rng));
+        total += (uint32_t)documents.back().size();
+    }
+
+    std::cout << documents.size() << " documents, " << n << " characters in all\n"
+              << std::setw(24) << "" << std::setw(14) << "new tree (us)" << std::setw(14) << "reset (us)" << '\n';
+    for (auto [name, options] : {std::pair{"single_nf profile", SuffixTree::Options::for_single_nf()},
+                                 std::pair{"all_nf profile", SuffixTree::Options::for_all_nf()}}) {
+        auto fresh = seconds([&] {
+            for (const auto& document : documents) SuffixTree st{document, options};
+        });
+        SuffixTree st{documents.front(), options};
+        auto reused = seconds([&] {
+            for (const auto& document : documents) st.reset(document);
+        });
+        std::cout << std::setw(24) << name << std::setw(14) << fresh / (double)documents.size() * 1e6
+                  << std::setw(14) << reused / (double)documents.size() * 1e6 << '\n';
+    }
+}
+
+
+// ==========================================================================================
+//              end-to-end all_nf: Ukkonen's suffix tree vs the parallel suffix array
+// ==========================================================================================
+
+static void bench_nf(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = random_text(n, 4, rng);
+
+    std::cout << "text length " << txt.size() << '\n';
+    auto tree = quiet_seconds([&] { SuffixTree st{txt, SuffixTree::Options::for_all_nf()}; st.all_nf(); });
+    std::cout << std::setw(24) << "suffix tree" << std::setw(14) << tree << '\n';
+    for (unsigned threads = 1; threads <= resolve_threads(0); threads *= 2) {
+        auto time = quiet_seconds([&] { SuffixArray sa{txt, threads}; sa.all_nf(); });
+        std::cout << std::setw(14) << "suffix array, " << std::setw(2) << threads << " threads"
+                  << std::setw(14) << time << '\n';
+    }
+}
+
+
+// ==========================================================================================
+//            external memory: all_nf within a memory budget of one byte per character
+// ==========================================================================================
+
+static void bench_external(uint32_t n) {
+    std::mt19937 rng(42);
+    auto dir = std::filesystem::temp_directory_path() / "bench_nf";
+    std::filesystem::create_directories(dir);
+    {
+        std::ofstream file(dir / "text", std::ios::binary);
+        file << random_text(n, 4, rng);
+    }
+
+    auto budget = std::max<size_t>(n, ExternalNF::min_budget);
+    std::cout << "text length " << n + 2 << ", memory budget " << budget << " bytes\n";
+    ExternalNF* external = nullptr;
+    auto build = seconds([&] { external = new ExternalNF((dir / "text").string(), dir.string(), budget); });
+    auto sweep = quiet_seconds([&] { external->all_nf(); });
+    std::cout << std::setw(24) << "construction (s)" << std::setw(14) << build << '\n'
+              << std::setw(24) << "all_nf (s)" << std::setw(14) << sweep << '\n'
+              << std::setw(24) << "read (bytes)" << std::setw(14) << external->bytes_read << '\n'
+              << std::setw(24) << "written (bytes)" << std::setw(14) << external->bytes_written << '\n'
+              << std::setw(24) << "text read (bytes)" << std::setw(14) << external->text_bytes << '\n';
+    delete external;
+    std::filesystem::remove_all(dir);
+}
+
+
+// ==========================================================================================
+//          single_nf queries: the full suffix tree vs the lazy (on demand) suffix tree
+// ==========================================================================================
+
+template <typename Tree>
+static void bench_queries(const char* name, const std::string& txt, const std::vector<std::string>& patterns) {
+    Tree* tree = nullptr;
+    auto first = seconds([&] { tree = new Tree{txt}; tree->single_nf(patterns[0]); });
+    auto rest = seconds([&] {
+        for (const auto& pattern : patterns) tree->single_nf(pattern);
+    });
+    std::cout << std::setw(24) << name << std::setw(16) << first << std::setw(16) << rest << '\n';
+    delete tree;
+}
+
+static void bench_lazy(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = random_text(n, 4, rng);
+    auto patterns = random_patterns(txt, 5000, 8, rng);
+
+    std::cout << "text length " << txt.size() << ", " << patterns.size() << " patterns\n"
+              << std::setw(24) << "" << std::setw(16) << "first query (s)" << std::setw(16) << "all queries (s)" << '\n';
+    bench_queries<LazySuffixTree>("lazy suffix tree", txt, patterns);
+    bench_queries<SuffixTree>("suffix tree", txt, patterns);
+}
+
+
+// ==========================================================================================
+//    space and query times: the pointer suffix tree vs its succinct copy vs compressed indexes
+// ==========================================================================================
+
+template <typename Tree>
+static void bench_space(const char* name, const std::string& txt, const std::vector<std::string>& patterns) {
+    auto before = heap_bytes();
+    Tree* tree = nullptr;
+    auto build = seconds([&] { tree = new Tree{txt}; });
+    auto bytes = heap_bytes() - before;
+    auto queries = seconds([&] {
+        for (const auto& pattern : patterns) tree->single_nf(pattern);
+    });
+    std::cout << std::setw(24) << name << std::setw(14) << (double)bytes * 8 / (double)txt.size()
+              << std::setw(14) << build << std::setw(16) << queries / (double)patterns.size() * 1e6;
+    // (the FM-index and the enhanced suffix array only answer single_nf)
+    if constexpr (requires { tree->all_nf(); }) {
+        auto all = quiet_seconds([&] { tree->all_nf(); });
+        std::cout << std::setw(14) << all;
+    }
+    std::cout << '\n';
+    delete tree;
+}
+
+// the same suffix tree before and after `freeze` (the heap layout of two separate trees differs too much)
+static void bench_frozen(const std::string& txt, const std::vector<std::string>& patterns) {
+    auto before = heap_bytes();
+    SuffixTree* st = nullptr;
+    auto construction = seconds([&] { st = new SuffixTree{txt}; });
+    double build[2], bytes[2], queries[2], all[2];
+    for (int frozen : {0, 1}) {
+        // (the second row adds the time of freeze, all_nf is run last as it leaves its output buffer behind)
+        build[frozen] = frozen ? construction + seconds([&] { st->freeze(); }) : construction;
+        bytes[frozen] = (double)(heap_bytes() - before);
+        queries[frozen] = seconds([&] {
+            for (const auto& pattern : patterns) st->single_nf(pattern);
+        });
+    }
+    all[0] = all[1] = quiet_seconds([&] { st->all_nf(); });
+    for (int frozen : {0, 1}) {
+        std::cout << std::setw(24) << (frozen ? "suffix tree, frozen" : "suffix tree")
+                  << std::setw(14) << bytes[frozen] * 8 / (double)txt.size()
+                  << std::setw(14) << build[frozen] << std::setw(16) << queries[frozen] / (double)patterns.size() * 1e6
+                  << std::setw(14) << all[frozen] << '\n';
+    }
+    delete st;
+}
+
+static void bench_compressed(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = random_text(n, 4, rng);
+    auto patterns = random_patterns(txt, 5000, 8, rng);
+
+    std::cout << "text length " << txt.size() << '\n'
+              << std::setw(24) << "" << std::setw(14) << "bits/char" << std::setw(14) << "build (s)"
+              << std::setw(16) << "single_nf (us)" << std::setw(14) << "all_nf (s)" << '\n';
+    bench_frozen(txt, patterns);
+    bench_space<SuccinctSuffixTree>("succinct suffix tree", txt, patterns);
+    bench_space<CompressedSuffixTree>("compressed suffix tree", txt, patterns);
+    bench_space<FMIndex>("FM-index", txt, patterns);
+    bench_space<EnhancedSuffixArray>("enhanced suffix array", txt, patterns);
+}
+
+
+// ==========================================================================================
+//           repetitive collections: the compressed suffix tree vs the r-index
+// ==========================================================================================
+
+// `copies` versions of a random document of length n / copies, each with 0.1% of its characters substituted
+static std::string repetitive_text(uint32_t n, uint32_t copies, std::mt19937& rng) {
+    auto base = random_text(n / copies, 4, rng);
+    base = base.substr(1, base.size() - 2);
+    std::uniform_int_distribution<uint32_t> pos(0, (uint32_t)base.size() - 1), c(0, 3);
+    std::string txt = "#";
+    for (uint32_t copy = 0; copy < copies; copy++) {
+        auto version = base;
+        for (uint32_t e = 0; e < version.size() / 1000; e++) version[pos(rng)] = (char)('a' + c(rng));
+        txt += version;
+    }
+    return txt + "$";
+}
+
+template <typename Index>
+static void bench_index(const char* name, const std::string& txt, const std::vector<std::string>& patterns) {
+    Index* index = nullptr;
+    auto build = seconds([&] { index = new Index{txt}; });
+    auto queries = seconds([&] {
+        for (const auto& pattern : patterns) index->single_nf(pattern);
+    });
+    auto all = quiet_seconds([&] { index->all_nf(); });
+    std::cout << std::setw(24) << name << std::setw(14) << (double)index->size_in_bytes() * 8 / (double)txt.size()
+              << std::setw(14) << build << std::setw(16) << queries / (double)patterns.size() * 1e6
+              << std::setw(14) << all << '\n';
+    delete index;
+}
+
+static void bench_repetitive(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = repetitive_text(n, 100, rng);
+    auto patterns = random_patterns(txt, 5000, 8, rng);
+
+    std::cout << "text length " << txt.size() << ", " << RIndex{txt}.runs() << " BWT runs\n"
+              << std::setw(24) << "" << std::setw(14) << "bits/char" << std::setw(14) << "build (s)"
+              << std::setw(16) << "single_nf (us)" << std::setw(14) << "all_nf (s)" << '\n';
+    bench_index<CompressedSuffixTree>("compressed suffix tree", txt, patterns);
+    bench_index<RIndex>("r-index", txt, patterns);
+}
+
+// the full suffix tree vs trees truncated for the NF of strings of at most k characters
+static void bench_truncated(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = repetitive_text(n, 100, rng);
+
+    std::cout << "text length " << txt.size() << '\n'
+              << std::setw(24) << "" << std::setw(14) << "bits/char" << std::setw(14) << "nodes"
+              << std::setw(14) << "build (s)" << std::setw(14) << "all_nf (s)" << '\n';
+    for (index_t k : {0u, 30u, 10u}) {
+        auto before = heap_bytes();
+        SuffixTree* st = nullptr;
+        auto build = seconds([&] {
+            st = k == 0 ? new SuffixTree{txt} : new SuffixTree{txt, SuffixTree::Truncated{k}};
+        });
+        auto bytes = heap_bytes() - before;
+        auto all = quiet_seconds([&] { st->all_nf(); });
+        std::cout << std::setw(24) << (k == 0 ? "full" : "truncated, k = " + std::to_string(k))
+                  << std::setw(14) << (double)bytes * 8 / (double)txt.size() << std::setw(14) << st->internal_nodes()
+                  << std::setw(14) << build << std::setw(14) << all << '\n';
+        delete st;
+    }
+}
+
+
+// ==========================================================================================
+//          natural-language text: all suffixes vs the suffixes at the starts of the words
+// ==========================================================================================
+
+// words of 2 to 8 random lowercase letters drawn from a vocabulary of 5000, with Zipfian frequencies, separated by spaces
+static std::string word_text(uint32_t n, std::mt19937& rng) {
+    std::vector<std::string> vocabulary(5000);
+    std::uniform_int_distribution<uint32_t> len(2, 8), letter(0, 25);
+    for (auto& word : vocabulary) {
+        for (auto l = len(rng); l > 0; l--) word.push_back((char)('a' + letter(rng)));
+    }
+    std::vector<double> weights;
+    for (uint32_t r = 1; r <= vocabulary.size(); r++) weights.push_back(1.0 / r);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    std::string txt = "#";
+    while (txt.size() < n) txt += vocabulary[pick(rng)] + ' ';
+    return txt + "$";
+}
+
+static void bench_sparse(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = word_text(n, rng);
+    std::vector<index_t> starts;
+    for (index_t i = 0; i < txt.size(); i++) {
+        if (i == 0 || txt[i - 1] == ' ') starts.push_back(i);
+    }
+    std::vector<std::string> patterns;
+    std::uniform_int_distribution<size_t> pick(0, starts.size() - 2);
+    for (uint32_t p = 0; p < 200000; p++) {
+        auto start = starts[pick(rng)];
+        patterns.push_back(txt.substr(start, std::min<size_t>(txt.find(' ', start) - start, 12)));
+    }
+
+    std::cout << "text length " << txt.size() << ", " << starts.size() << " words\n"
+              << std::setw(24) << "" << std::setw(14) << "bits/char" << std::setw(14) << "nodes" << std::setw(14) << "build (s)"
+              << std::setw(16) << "single_nf (us)" << std::setw(14) << "all_nf (s)" << '\n';
+    for (bool sparse : {false, true}) {
+        auto before = heap_bytes();
+        SuffixTree* st = nullptr;
+        auto build = seconds([&] {
+            st = sparse ? new SuffixTree{txt, SuffixTree::Sparse{starts}} : new SuffixTree{txt};
+        });
+        auto bytes = heap_bytes() - before;
+        auto queries = seconds([&] {
+            for (const auto& pattern : patterns) st->single_nf(pattern);
+        });
+        auto all = quiet_seconds([&] { st->all_nf(); });
+        std::cout << std::setw(24) << (sparse ? "word starts" : "all suffixes")
+                  << std::setw(14) << (double)bytes * 8 / (double)txt.size() << std::setw(14) << st->internal_nodes()
+                  << std::setw(14) << build << std::setw(16) << queries / (double)patterns.size() * 1e6
+                  << std::setw(14) << all << '\n';
+        delete st;
+    }
+}
+
+
+// ==========================================================================================
+//              node layout: the same suffix tree before and after relayout
+// ==========================================================================================
+
+static void bench_layout(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = random_text(n, 4, rng);
+    auto patterns = random_patterns(txt, 200000, 12, rng);
+
+    std::cout << "text length " << txt.size() << '\n'
+              << std::setw(24) << "" << std::setw(14) << "lookup (us)" << std::setw(16) << "single_nf (us)"
+              << std::setw(14) << "all_nf (s)" << '\n';
+    SuffixTree st{txt};
+    for (bool relaid : {false, true}) {
+        if (relaid) {
+            auto time = seconds([&] { st.relayout(); });
+            std::cout << std::setw(24) << "relayout" << std::setw(14) << time << " s\n";
+        }
+        auto lookups = seconds([&] {
+            for (const auto& pattern : patterns) st.find_internal_node(pattern);
+        });
+        auto queries = seconds([&] {
+            for (const auto& pattern : patterns) st.single_nf(pattern);
+        });
+        auto all = quiet_seconds([&] { st.all_nf(); });
+        std::cout << std::setw(24) << (relaid ? "preorder" : "insertion order")
+                  << std::setw(14) << lookups / (double)patterns.size() * 1e6
+                  << std::setw(16) << queries / (double)patterns.size() * 1e6 << std::setw(14) << all << '\n';
+    }
+}
+
+
+// ==========================================================================================
+//          alphabet size: the children in the edge table vs the default (dense arrays where smaller)
+// ==========================================================================================
+
+static void bench_alphabet(uint32_t n) {
+    std::cout << "text length " << n + 2 << '\n'
+              << std::setw(8) << "sigma" << std::setw(16) << "" << std::setw(14) << "build (s)"
+              << std::setw(14) << "memory (MB)" << std::setw(14) << "lookup (us)" << std::setw(16) << "single_nf (us)" << '\n';
+    // (the terminators add two characters to the alphabet)
+    for (uint32_t sigma : {2u, 4u, 6u, 10u, 14u, 26u, 40u, 60u}) {
+        std::mt19937 rng(42);
+        std::string txt = random_text(n, sigma, rng);
+        auto patterns = random_patterns(txt, 200000, 8, rng);
+        for (unsigned dense_sigma : {0u, SuffixTree::Options{}.dense_sigma}) {
+            SuffixTree::Options options;
+            options.dense_sigma = dense_sigma;
+            SuffixTree* st = nullptr;
+            auto before = heap_bytes();
+            auto build = seconds([&] { st = new SuffixTree{txt, options}; });
+            auto mb = (double)(heap_bytes() - before) / (1 << 20);
+            auto lookups = seconds([&] {
+                for (const auto& pattern : patterns) st->find_internal_node(pattern);
+            });
+            auto queries = seconds([&] {
+                for (const auto& pattern : patterns) st->single_nf(pattern);
+            });
+            std::cout << std::setw(8) << sigma + 2 << std::setw(16) << (dense_sigma == 0 ? "edge table" : "default")
+                      << std::setw(14) << build << std::setw(14) << mb << std::setw(14) << lookups / (double)patterns.size() * 1e6
+                      << std::setw(16) << queries / (double)patterns.size() * 1e6 << '\n';
+            delete st;
+        }
+    }
+}
+
+
+// ==========================================================================================
+//     memory backing: the nodes in the default heap vs transparent or explicit huge pages
+// ==========================================================================================
+
+static void print_counts(const TlbCounters::Counts& counts) {
+    for (auto count : {counts.dtlb_load_misses, counts.dtlb_store_misses, counts.page_faults}) {
+        if (count < 0) std::cout << std::setw(14) << "n/a";
+        else std::cout << std::setw(14) << count;
+    }
+}
+
+static void bench_huge_pages(uint32_t n) {
+    std::mt19937 rng(42);
+    std::string txt = random_text(n, 4, rng);
+
+    std::cout << "text length " << txt.size() << " (dTLB misses are n/a without access to the PMU)\n"
+              << std::setw(32) << "" << std::setw(14) << "time (s)" << std::setw(14) << "dTLB loads"
+              << std::setw(14) << "dTLB stores" << std::setw(14) << "page faults" << '\n';
+    std::pair<const char*, MemoryPolicy> policies[] = {
+        {"heap", {MemoryPolicy::Pages::normal, false}},
+        {"transparent", {MemoryPolicy::Pages::transparent, false}},
+        {"huge", {MemoryPolicy::Pages::huge, false}},
+        {"transparent, interleave", {MemoryPolicy::Pages::transparent, true}},
+    };
+    TlbCounters counters;
+    for (auto& [name, policy] : policies) {
+        SuffixTree::Options options = SuffixTree::Options::for_all_nf();
+        options.memory = policy;
+        std::unique_ptr<SuffixTree> st;
+        counters.start();
+        auto build = seconds([&] { st = std::make_unique<SuffixTree>(txt, options); });
+        auto build_counts = counters.stop();
+        counters.start();
+        auto all = quiet_seconds([&] { st->all_nf(); });
+        auto all_counts = counters.stop();
+        std::cout << std::setw(32) << (std::string(name) + ", build") << std::setw(14) << build;
+        print_counts(build_counts);
+        std::cout << '\n' << std::setw(32) << (std::string(name) + ", all_nf") << std::setw(14) << all;
+        print_counts(all_counts);
+        std::cout << '\n';
+    }
+}
+
+
+// ==========================================================================================
+//        texts past 4 GiB: a suffix tree with 64-bit positions (make bench INDEX64=1)
+// ==========================================================================================
+
+/*
+the text is a sparse file of n bytes mapped into memory, zeros but for a few words, so that it costs neither memory nor disk:
+ - "fgh" is planted at n/4 and "fgi" 4096 bytes before the end (past 4 GiB by default), between "#" at the start,
+   "xyz" at n/2 and the terminator "$";
+ - a sparse tree over the starts of the words has a handful of nodes, and has NF(fg) = 2 with the leaves of fg
+   at the planted positions only if positions beyond 2^32 are represented correctly
+   (a full suffix tree of such a text would take hundreds of GB);
+ - with 32-bit positions, every constructor refuses the text up front
+*/
+static void bench_large(uint64_t n) {
+    n = std::max<uint64_t>(n, 8192);
+    auto path = (std::filesystem::temp_directory_path() / "nf_bench_large").string();
+    auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    std::vector<std::pair<uint64_t, std::string>> words{{0, "#"}, {n / 4, "fgh"}, {n / 2, "xyz"}, {n - 4096, "fgi"}, {n - 1, "$"}};
+    bool written = fd >= 0 && ::ftruncate(fd, (off_t)n) == 0;
+    for (const auto& [pos, word] : words) {
+        written = written && ::pwrite(fd, word.data(), word.size(), (off_t)pos) == (ssize_t)word.size();
+    }
+    void* mapped = written ? ::mmap(nullptr, n, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (mapped == MAP_FAILED) {
+        std::cout << "cannot map a text of " << n << " bytes in " << path << '\n';
+        if (fd >= 0) ::close(fd);
+        std::filesystem::remove(path);
+        return;
+    }
+    std::string_view txt{static_cast<const char*>(mapped), n};
+
+    std::cout << "text length " << txt.size() << ", " << sizeof(index_t) * 8 << "-bit positions\n";
+    // (with 32-bit positions and a text past 4 GiB, the constructor throws before reading them)
+    std::vector<index_t> positions;
+    for (const auto& word : words) positions.push_back((index_t)word.first);
+    try {
+        SuffixTree* st = nullptr;
+        auto build = seconds([&] { st = new SuffixTree{txt, SuffixTree::Sparse{positions}}; });
+        auto nf = st->single_nf("fg");
+        std::vector<uint64_t> leaves;
+        auto [node, rest] = st->find_internal_node("fg");
+        if (node != nullptr && rest == 0) {
+            for (const auto& [c, child] : st->children(node)) {
+                if (child.is_leaf()) leaves.push_back(child.suffix());
+            }
+        }
+        bool ok = nf == 2 && leaves == std::vector<uint64_t>{n / 4, n - 4096};
+        std::cout << "sparse suffix tree over " << positions.size() << " positions, build (s) " << build
+                  << ", NF(fg) = " << nf << ", fg at";
+        for (auto leaf : leaves) std::cout << ' ' << leaf;
+        std::cout << (ok ? " (ok)" : " (wrong)") << '\n';
+        delete st;
+    }
+    catch (const std::length_error& e) {
+        std::cout << e.what() << '\n';
+    }
+
+    // the structures limited to 32-bit positions refuse such a text up front
+    auto refuses = [](auto build) {
+        try {
+            build();
+        }
+        catch (const std::length_error& e) {
+            std::cout << e.what() << '\n';
+        }
+    };
+    if (txt.size() >= std::numeric_limits<uint32_t>::max()) {
+        refuses([&] { FMIndex{txt}; });
+        refuses([&] { RIndex{txt}; });
+        refuses([&] { CompressedSuffixTree{txt}; });
+        refuses([&] { LazySuffixTree{txt}; });
+    }
+    ::munmap(mapped, n);
+    ::close(fd);
+    std::filesystem::remove(path);
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " edits|build|reset|nf|external|lazy|compressed|repetitive|truncated|sparse|layout|alphabet|hugepages|large [n]\n";
+        return 1;
+    }
+    if (std::strcmp(argv[1], "large") == 0) {
+        bench_large(argc > 2 ? std::stoull(argv[2]) : ((uint64_t)1 << 32) + ((uint64_t)1 << 24));
+        return 0;
+    }
+    uint32_t n = argc > 2 ? (uint32_t)std::stoul(argv[2]) : 1000000;
+
+    if (std::strcmp(argv[1], "edits") == 0) bench_edits(n);
+    else if (std::strcmp(argv[1], "build") == 0) bench_build(n);
+    else if (std::strcmp(argv[1], "reset") == 0) bench_reset(n);
+    else if (std::strcmp(argv[1], "nf") == 0) bench_nf(n);
+    else if (std::strcmp(argv[1], "external") == 0) bench_external(n);
+    else if (std::strcmp(argv[1], "lazy") == 0) bench_lazy(n);
+    else if (std::strcmp(argv[1], "compressed") == 0) bench_compressed(n);
+    else if (std::strcmp(argv[1], "repetitive") == 0) bench_repetitive(n);
+    else if (std::strcmp(argv[1], "truncated") == 0) bench_truncated(n);
+    else if (std::strcmp(argv[1], "sparse") == 0) bench_sparse(n);
+    else if (std::strcmp(argv[1], "layout") == 0) bench_layout(n);
+    else if (std::strcmp(argv[1], "alphabet") == 0) bench_alphabet(n);
+    else if (std::strcmp(argv[1], "hugepages") == 0) bench_huge_pages(n);
+    else {
+        std::cerr << "unknown benchmark " << argv[1] << '\n';
+        return 1;
+    }
+    return 0;
+}
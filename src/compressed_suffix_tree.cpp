@@ -0,0 +1,249 @@
+#include "./compressed_suffix_tree.hpp"
+#include "./suffix_array.hpp"
+#include "./index.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <algorithm> // std::min, std::count
+
+
+
+// ==========================================================================================
+//                                  FM-index related
+// ==========================================================================================
+
+size_t CompressedSuffixTree::rank(unsigned char c, uint32_t k) const {
+    auto r = bwt.rank(c, k);
+    if (c == 0 && terminator_row < k) r--;
+    return r;
+}
+
+// the row of suffix i-1, given the row k of suffix i (i > 0)
+uint32_t CompressedSuffixTree::lf(uint32_t k) const {
+    auto c = bwt.access(k);
+    return C[c] + (uint32_t)rank(c, k);
+}
+
+// the suffix in row k: walk back to a sampled suffix
+uint32_t CompressedSuffixTree::locate(uint32_t k) const {
+    uint32_t steps = 0;
+    while (!sampled.get(k)) {
+        k = lf(k);
+        steps++;
+    }
+    return (uint32_t)sa_samples.get(sampled.rank1(k)) + steps;
+}
+
+uint32_t CompressedSuffixTree::lcp(uint32_t k) const {
+    auto i = locate(k);
+    return (uint32_t)plcp.select1(i) - 2 * i;
+}
+
+// txt[i...i+len), walking back from the first sampled suffix at or after i+len
+std::string CompressedSuffixTree::extract(uint32_t i, uint32_t len) const {
+    std::string s(len, '\0');
+    auto p = std::min(n, (i + len + rate - 1) / rate * rate);
+    auto k = p == n ? 0 : (uint32_t)isa_samples.get(p / rate);
+    for (; p > i; p--) {
+        if (p - 1 < i + len) s[p - 1 - i] = (char)bwt.access(k);
+        k = lf(k);
+    }
+    return s;
+}
+
+std::pair<uint32_t, uint32_t> CompressedSuffixTree::leaf_range(size_t v) const {
+    return {(uint32_t)bp.leaf_rank(v), (uint32_t)bp.leaf_rank(bp.find_close(v))};
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+
+
+/*
+compute the net frequency of a single substring s:
+ - backward search gives the rows [l, r) of the suffixes starting with s;
+ - the locus of s is the lowest node above leaf l whose leaves reach r,
+   s is branching iff the string depth of the locus (the LCP where its second child starts) is |s|;
+ - a leaf child in row k counts iff x = bwt[k] occurs once in bwt[l...r), i.e., iff xS is unique
+*/
+uint32_t CompressedSuffixTree::single_nf(std::string_view s) {
+    uint32_t l = 0, r = n + 1;
+    for (auto c = s.rbegin(); c != s.rend() && l < r; c++) {
+        auto x = (unsigned char)*c;
+        l = C[x] + (uint32_t)rank(x, l);
+        r = C[x] + (uint32_t)rank(x, r);
+    }
+    // s doesn't exist, or is unique
+    if (r <= l + 1) return 0;
+
+    auto v = bp.leaf_select(l);
+    do {
+        v = bp.enclose(v);
+    } while (leaf_range(v).second < r);
+    assert(leaf_range(v).first == l && leaf_range(v).second == r);
+    // s is non-branching
+    auto second = bp.find_close(v + 1) + 1;
+    if (lcp((uint32_t)bp.leaf_rank(second)) != s.size()) return 0;
+
+    uint32_t nf = 0;
+    for (auto child = v + 1; bp.is_open(child); child = bp.find_close(child) + 1) {
+        if (bp.is_open(child + 1)) continue;
+        auto k = (uint32_t)bp.leaf_rank(child);
+        if (k == terminator_row) {
+            nf++;
+            continue;
+        }
+        auto x = bwt.access(k);
+        if (rank(x, r) - rank(x, l) == 1) nf++;
+    }
+    return nf;
+}
+
+
+/*
+compute the net frequencies for all the branching substrings in one scan of the parentheses:
+ - a node's rows [lb, rb) are known when it closes, and a leaf child in row k counts iff it is suffix 0
+   or x = bwt[k] occurs once in bwt[lb...rb) (as in single_nf);
+ - the string of a node is the prefix of the suffix in its second child's first row,
+   whose length is the LCP of that row (a locate and a PLCP select)
+*/
+void CompressedSuffixTree::all_nf() {
+    struct Node {
+        // its first row, where its leaf children start in `pending`, its number of children
+        // and the first row of its second child
+        uint32_t lb, leaves, children, second;
+    };
+    std::vector<Node> stack;
+    std::vector<uint32_t> pending;
+    uint32_t row = 0;
+    // a child starts in the current row
+    auto child = [&] {
+        if (stack.empty()) return;
+        if (++stack.back().children == 2) stack.back().second = row;
+    };
+    for (size_t pos = 0; pos < bp.size(); pos++) {
+        if (bp.is_open(pos) && !bp.is_open(pos + 1)) {
+            child();
+            pending.push_back(row++);
+            pos++;
+        }
+        else if (bp.is_open(pos)) {
+            child();
+            stack.push_back({row, (uint32_t)pending.size(), 0, 0});
+        }
+        else {
+            auto S = stack.back();
+            stack.pop_back();
+            // the root is not reported
+            uint32_t nf = 0;
+            for (auto p = pending.begin() + S.leaves; p != pending.end() && !stack.empty(); p++) {
+                if (*p == terminator_row) {
+                    nf++;
+                    continue;
+                }
+                auto x = bwt.access(*p);
+                if (rank(x, row) - rank(x, S.lb) == 1) nf++;
+            }
+            pending.resize(S.leaves);
+            if (nf) {
+                auto i = locate(S.second);
+                std::cout << extract(i, (uint32_t)plcp.select1(i) - 2 * i) << '\t' << nf << std::endl;
+            }
+        }
+    }
+}
+
+
+
+
+// ==========================================================================================
+//                                  other functions
+// ==========================================================================================
+
+
+// compressed suffix tree constructor, via a (temporary) suffix array
+CompressedSuffixTree::CompressedSuffixTree(std::string_view txt, uint32_t _rate, unsigned threads) :
+    n((uint32_t)check_length32(txt.size(), "CompressedSuffixTree")),
+    C(257, 0),
+    rate(_rate) {
+    assert(txt.empty() || std::count(txt.begin(), txt.end(), txt.back()) == 1);
+    SuffixArray sa{txt, threads};
+    auto rows = n + 1;
+    // the row of suffix sa.sa[k] is k+1
+    auto suffix = [&](uint32_t k) { return k == 0 ? n : (uint32_t)sa.sa[k - 1]; };
+    auto row_lcp = [&](uint32_t k) { return k <= 1 ? 0 : (uint32_t)sa.lcp[k - 1]; };
+
+    std::string last(rows, '\0');
+    if (n > 0) last[0] = txt[n - 1];
+    for (uint32_t k = 0; k < n; k++) last[k + 1] = sa.bwt[k];
+    terminator_row = (uint32_t)sa.primary + 1;
+    bwt = WaveletTree(last);
+
+    for (auto c : txt) C[(unsigned char)c + 1]++;
+    C[0] = 1;
+    for (size_t c = 1; c < C.size(); c++) C[c] += C[c - 1];
+
+    sampled = BitVector(rows);
+    sa_samples = IntVector((n + rate - 1) / rate + 1, n);
+    isa_samples = IntVector((n + rate - 1) / rate, n);
+    for (uint32_t k = 0, j = 0; k < rows; k++) {
+        auto i = suffix(k);
+        if (i == n || i % rate == 0) {
+            sampled.set(k);
+            sa_samples.set(j++, i);
+        }
+        if (i < n && i % rate == 0) isa_samples.set(i / rate, k);
+    }
+    sampled.build();
+
+    // PLCP, in text order
+    std::vector<uint32_t> by_text(n);
+    plcp = BitVector(2 * (size_t)n + 1);
+    for (uint32_t k = 1; k < rows; k++) by_text[suffix(k)] = row_lcp(k);
+    for (uint32_t i = 0; i < n; i++) plcp.set(by_text[i] + 2 * (size_t)i);
+    plcp.build();
+    std::vector<uint32_t>().swap(by_text);
+
+    // the lcp-intervals (internal nodes other than the root) open before their first leaf
+    // and close after their last one
+    std::vector<uint32_t> opens(rows, 0), closes(rows, 0);
+    struct Interval {
+        uint32_t lcp, lb;
+    };
+    std::vector<Interval> stack{{0, 0}};
+    uint32_t internal = 0;
+    for (uint32_t k = 1; k <= rows; k++) {
+        auto cur = k < rows ? row_lcp(k) : 0;
+        auto lb = k - 1;
+        while (cur < stack.back().lcp) {
+            opens[stack.back().lb]++;
+            closes[k - 1]++;
+            internal++;
+            lb = stack.back().lb;
+            stack.pop_back();
+        }
+        if (cur > stack.back().lcp) stack.push_back({cur, lb});
+    }
+
+    BitVector bits(2 * ((size_t)rows + internal + 1));
+    size_t pos = 0;
+    bits.set(pos++);
+    for (uint32_t k = 0; k < rows; k++) {
+        for (uint32_t o = 0; o < opens[k]; o++) bits.set(pos++);
+        bits.set(pos);
+        pos += 2 + closes[k];
+    }
+    bp = BalancedParentheses(std::move(bits));
+}
+
+size_t CompressedSuffixTree::size_in_bytes() const {
+    return bwt.size_in_bytes() + C.size() * sizeof(uint32_t) +
+           sampled.size_in_bytes() + sa_samples.size_in_bytes() + isa_samples.size_in_bytes() +
+           plcp.size_in_bytes() +
+           bp.size_in_bytes();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "./succinct.hpp"
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <utility> // std::pair
+#include <cstdint>
+
+
+// a compressed suffix tree: the BWT in a Huffman-shaped wavelet tree (FM-index), a sampled suffix array,
+// the LCP array as a 2n-bit PLCP bit vector and the topology as balanced parentheses,
+// the text itself is not kept (substrings are extracted from the BWT);
+// about 11 bits per character on random text over 4 letters and 12 on repetitive text (vs ~128 bytes for SuffixTree),
+// but all_nf is ~45x slower than the suffix tree's (3.3 s vs 0.075 s at 1M)
+class CompressedSuffixTree {
+private:
+    // the length of the text, the suffix array has n+1 rows, row 0 being the empty suffix
+    uint32_t n;
+
+    // the BWT, where the row of suffix 0 (whose preceding character is the virtual terminator)
+    // holds a placeholder 0 that rank() discounts
+    WaveletTree bwt;
+    uint32_t terminator_row;
+    // C[c] = the number of rows whose suffix starts with a character smaller than c (the empty one included)
+    std::vector<uint32_t> C;
+
+    // every `rate`-th suffix (in text order) is sampled, as well as the empty suffix
+    uint32_t rate;
+    BitVector sampled;
+    IntVector sa_samples;
+    // isa_samples[j] = the row of suffix j * rate
+    IntVector isa_samples;
+
+    // PLCP[i] = the LCP of suffix i with the suffix before it in the suffix array,
+    // PLCP[i] + i is non-decreasing, so it is stored as a 1 at position PLCP[i] + 2i
+    BitVector plcp;
+
+    // the topology, the leaves ("()") are in suffix array order
+    BalancedParentheses bp;
+
+    size_t rank(unsigned char c, uint32_t k) const;
+    uint32_t lf(uint32_t k) const;
+    uint32_t locate(uint32_t k) const;
+    uint32_t lcp(uint32_t k) const;
+    std::string extract(uint32_t i, uint32_t len) const;
+    // the rows of the leaves below node v
+    std::pair<uint32_t, uint32_t> leaf_range(size_t v) const;
+
+public:
+    // constructor, the text must end with a unique terminator (32-bit positions, see check_length32 in index.hpp)
+    CompressedSuffixTree(std::string_view txt, uint32_t _rate = 64, unsigned threads = 0);
+
+    uint32_t single_nf(std::string_view s);
+
+    void all_nf();
+
+    size_t size_in_bytes() const;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <assert.h>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+
+// the edges of all the nodes of a tree in one array of sigma slots per node: the edge of node v starting with c
+// lies at v * sigma + rank(c), where rank is the position of c in the alphabet, so a lookup is a single read
+// with no hashing or probing; meant for small alphabets, as every node pays for sigma slots
+// (an empty slot holds Value{}, for which empty() must hold)
+template <typename Value>
+class DenseEdges {
+private:
+    std::vector<Value> slots;
+    // rank[c] = the position of c in the alphabet, -1 if it is not in it; chars[rank] = the character
+    int16_t rank[256];
+    char chars[256];
+    size_t sigma;
+    size_t count;
+
+    // the slot of the edge, or slots.size() if there is none
+    size_t locate(uint64_t node, char c) const {
+        auto r = rank[(unsigned char)c];
+        if (r < 0) return slots.size();
+        auto slot = node * sigma + (size_t)r;
+        return slot < slots.size() && !slots[slot].empty() ? slot : slots.size();
+    }
+
+public:
+    DenseEdges() : DenseEdges(std::string_view{}) {}
+
+    // an empty table for edges starting with the (distinct) characters of `alphabet`
+    explicit DenseEdges(std::string_view alphabet) { reset(alphabet); }
+
+    // remove every edge and rank the characters of another alphabet, keeping the memory
+    void reset(std::string_view alphabet) {
+        slots.clear();
+        sigma = alphabet.size();
+        count = 0;
+        for (auto& r : rank) r = -1;
+        for (auto& c : chars) c = 0;
+        for (size_t r = 0; r < sigma; r++) {
+            rank[(unsigned char)alphabet[r]] = (int16_t)r;
+            chars[r] = alphabet[r];
+        }
+    }
+
+    // room for the nodes 0 ... nodes-1 without growing
+    void reserve(size_t nodes) { slots.reserve(nodes * sigma); }
+
+    // the value of the edge of `node` starting with c, or nullptr
+    // (the pointer is invalidated by the next assign)
+    Value* find(uint64_t node, char c) {
+        auto slot = locate(node, c);
+        return slot == slots.size() ? nullptr : &slots[slot];
+    }
+    const Value* find(uint64_t node, char c) const {
+        auto slot = locate(node, c);
+        return slot == slots.size() ? nullptr : &slots[slot];
+    }
+
+    // insert the edge, or overwrite its value (c must be in the alphabet)
+    void assign(uint64_t node, char c, Value value) {
+        auto r = rank[(unsigned char)c];
+        assert(r >= 0);
+        auto slot = node * sigma + (size_t)r;
+        if (slot >= slots.size()) slots.resize((node + 1) * sigma);
+        if (slots[slot].empty()) count++;
+        slots[slot] = value;
+    }
+
+    // insert an edge known to be absent
+    void insert(uint64_t node, char c, Value value) {
+        assert(find(node, c) == nullptr);
+        assign(node, c, value);
+    }
+
+    bool erase(uint64_t node, char c) {
+        auto slot = locate(node, c);
+        if (slot == slots.size()) return false;
+        slots[slot] = {};
+        count--;
+        return true;
+    }
+
+    // remove every edge, keeping the memory
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    // call f(node, character, value) for every edge, in the order of the nodes and then of the characters
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t slot = 0; slot < slots.size(); slot++) {
+            if (!slots[slot].empty()) f((uint64_t)(slot / sigma), chars[slot % sigma], slots[slot]);
+        }
+    }
+
+    size_t size() const { return count; }
+
+    size_t size_in_bytes() const { return slots.capacity() * sizeof(Value); }
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "./edge_table.hpp"
+
+#include <vector>
+#include <algorithm> // std::max
+#include <utility> // std::pair
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+
+// a read-only copy of an EdgeTable as a double array: the children of node v lie at base[v] + rank(c),
+// where rank is the position of c among the characters labelling some edge, and check[slot] names the parent
+// holding the slot, so a lookup is a rank, a base and a check read with no probing;
+// the nodes are placed in the order of their ids, each at the first base (among a few tried)
+// where all its slots are free, the arrays growing when none fits
+template <typename Index, typename Value>
+class DoubleArray {
+private:
+    static constexpr Index none = std::numeric_limits<Index>::max();
+    // a free slot that fails this many placements is taken off the free list (it may still be filled by a later
+    // node placed around another slot) so that the search moves on
+    static constexpr uint8_t max_fails = 16;
+    // the number of free slots tried as the first child of a node before placing it at the end
+    static constexpr int max_tries = 32;
+
+    std::vector<Index> base;
+    std::vector<Index> check;
+    std::vector<Value> values;
+    // rank[c] = the rank of the character, -1 if no edge starts with it; chars[rank] = the character
+    int16_t rank[256];
+    char chars[256];
+    unsigned sigma;
+    size_t count;
+
+public:
+    DoubleArray() : sigma(0), count(0) {
+        for (auto& r : rank) r = -1;
+        for (auto& c : chars) c = 0;
+    }
+
+    // the edges of nodes 0 ... nodes-1
+    DoubleArray(const EdgeTable<Value>& edges, size_t nodes) : DoubleArray() {
+        bool seen[256] = {};
+        edges.for_each([&seen](uint64_t, char c, const Value&) { seen[(unsigned char)c] = true; });
+        for (int c = -128; c < 128; c++) {
+            if (!seen[(unsigned char)c]) continue;
+            rank[(unsigned char)c] = (int16_t)sigma;
+            chars[sigma++] = (char)c;
+        }
+
+        // the children of each node together, by counting sort on the parent
+        std::vector<size_t> offsets(nodes + 1, 0);
+        edges.for_each([&offsets](uint64_t node, char, const Value&) { offsets[node + 1]++; });
+        for (size_t v = 0; v < nodes; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        count = edges.size();
+        std::vector<std::pair<unsigned, Value>> children(count);
+        std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        edges.for_each([&](uint64_t node, char c, const Value& value) {
+            children[cursor[node]++] = {(unsigned)rank[(unsigned char)c], value};
+        });
+
+        // the free slots in a doubly linked list, in order
+        std::vector<Index> next, prev;
+        std::vector<uint8_t> fails;
+        Index head = none, tail = none;
+        auto unlink = [&](Index slot) {
+            (prev[slot] == none ? head : next[prev[slot]]) = next[slot];
+            (next[slot] == none ? tail : prev[next[slot]]) = prev[slot];
+        };
+        auto grow = [&](size_t size) {
+            while (check.size() < size) {
+                auto slot = (Index)check.size();
+                check.push_back(none);
+                values.push_back({});
+                next.push_back(none);
+                prev.push_back(tail);
+                fails.push_back(0);
+                (tail == none ? head : next[tail]) = slot;
+                tail = slot;
+            }
+        };
+
+        base.assign(nodes, 0);
+        size_t max_base = 0;
+        for (size_t v = 0; v < nodes; v++) {
+            auto first = children.begin() + (ptrdiff_t)offsets[v], last = children.begin() + (ptrdiff_t)offsets[v + 1];
+            if (first == last) continue;
+            auto fits = [&](size_t b) {
+                for (auto child = first; child != last; child++) {
+                    if (b + child->first < check.size() && check[b + child->first] != none) return false;
+                }
+                return true;
+            };
+
+            auto b = check.size();
+            auto slot = head;
+            for (int tries = 0; slot != none && tries < max_tries; tries++) {
+                auto following = next[slot];
+                if (slot >= first->first && fits(slot - first->first)) {
+                    b = slot - first->first;
+                    break;
+                }
+                if (++fails[slot] == max_fails) unlink(slot);
+                slot = following;
+            }
+
+            for (auto child = first; child != last; child++) {
+                grow(b + child->first + 1);
+                if (fails[b + child->first] < max_fails) unlink((Index)(b + child->first));
+                check[b + child->first] = (Index)v;
+                values[b + child->first] = child->second;
+            }
+            base[v] = (Index)b;
+            max_base = std::max(max_base, b);
+        }
+        // every base + rank is a valid slot
+        grow(max_base + sigma);
+    }
+
+    // the value of the edge of `node` starting with c, or nullptr
+    const Value* find(uint64_t node, char c) const {
+        auto r = rank[(unsigned char)c];
+        if (r < 0) return nullptr;
+        auto slot = base[node] + (size_t)r;
+        return check[slot] == node ? &values[slot] : nullptr;
+    }
+
+    // call f(node, character, value) for every edge, in the order of the slots
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t slot = 0; slot < check.size(); slot++) {
+            if (check[slot] != none) f((uint64_t)check[slot], chars[slot - base[check[slot]]], values[slot]);
+        }
+    }
+
+    // the number of edges
+    size_t size() const { return count; }
+
+    size_t size_in_bytes() const {
+        return base.capacity() * sizeof(Index) + check.capacity() * sizeof(Index) + values.capacity() * sizeof(Value);
+    }
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "./memory.hpp"
+
+#include <assert.h>
+#include <algorithm> // std::max
+#include <bit> // std::bit_ceil, std::countr_zero
+#include <utility> // std::swap
+#include <cstdint>
+#include <cstddef>
+
+
+// the edges of all the nodes of a tree in a single open-addressing hash table keyed by (node id, first character),
+// with Robin Hood insertion (an entry takes the slot of any entry closer to its own home slot)
+// and backward-shift deletion: a probe stops at an empty slot or at an entry closer to home than the key would be,
+// which keeps the probes short even at a high load factor
+template <typename Value>
+class EdgeTable {
+private:
+    struct Slot {
+        // (node << 8 | character) + 1, 0 marks an empty slot
+        uint64_t key;
+        Value value;
+    };
+    MemoryPolicy policy;
+    Slot* slots;
+    // a power of two (at least `min_capacity`) once the first entry is added
+    size_t capacity;
+    size_t count;
+    unsigned shift;
+
+    static constexpr size_t min_capacity = 16;
+
+    static uint64_t make_key(uint64_t node, char c) { return (node << 8 | (unsigned char)c) + 1; }
+    static size_t capacity_for(size_t n) {
+        return std::bit_ceil(std::max(min_capacity, (size_t)((double)n / max_load) + 1));
+    }
+    // Fibonacci hashing: the top bits of the key times 2^64 / phi
+    size_t home(uint64_t key) const { return (size_t)((key * 0x9E3779B97F4A7C15ull) >> shift); }
+    size_t distance(size_t i) const { return (i - home(slots[i].key)) & (capacity - 1); }
+
+    // the slot of the key, or `capacity` if it is absent
+    size_t locate(uint64_t key) const {
+        if (count == 0) return capacity;
+        auto i = home(key);
+        for (size_t d = 0;; d++, i = (i + 1) & (capacity - 1)) {
+            if (slots[i].key == key) return i;
+            if (slots[i].key == 0 || distance(i) < d) return capacity;
+        }
+    }
+
+    void place(Slot slot) {
+        auto i = home(slot.key);
+        for (size_t d = 0;; d++, i = (i + 1) & (capacity - 1)) {
+            if (slots[i].key == 0) {
+                slots[i] = slot;
+                return;
+            }
+            auto other = distance(i);
+            if (other < d) {
+                std::swap(slots[i], slot);
+                d = other;
+            }
+        }
+    }
+
+    void rehash(size_t new_capacity) {
+        auto old_slots = slots;
+        auto old_capacity = capacity;
+        slots = static_cast<Slot*>(map_memory(new_capacity * sizeof(Slot), policy));
+        capacity = new_capacity;
+        shift = 64 - (unsigned)std::countr_zero(capacity);
+        for (size_t i = 0; i < capacity; i++) slots[i].key = 0;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_slots[i].key != 0) place(old_slots[i]);
+        }
+        if (old_slots != nullptr) unmap_memory(old_slots, old_capacity * sizeof(Slot), policy);
+    }
+
+public:
+    // the table doubles past this load factor
+    static constexpr double max_load = 0.875;
+
+    EdgeTable(MemoryPolicy _policy = {}) : policy(_policy), slots(nullptr), capacity(0), count(0), shift(64) {}
+    EdgeTable(const EdgeTable&) = delete;
+    EdgeTable& operator=(const EdgeTable&) = delete;
+    EdgeTable(EdgeTable&& other) noexcept : EdgeTable(other.policy) { swap(other); }
+    EdgeTable& operator=(EdgeTable&& other) noexcept { swap(other); return *this; }
+    ~EdgeTable() {
+        if (slots != nullptr) unmap_memory(slots, capacity * sizeof(Slot), policy);
+    }
+
+    // room for n entries without growing
+    void reserve(size_t n) {
+        auto needed = capacity_for(n);
+        if (needed > capacity) rehash(needed);
+    }
+    // the memory of a table reserved for n entries
+    static size_t bytes_for(size_t n) { return capacity_for(n) * sizeof(Slot); }
+
+    // the value of the edge of `node` starting with c, or nullptr
+    // (the pointer is invalidated by the next assign or erase)
+    Value* find(uint64_t node, char c) {
+        auto i = locate(make_key(node, c));
+        return i == capacity ? nullptr : &slots[i].value;
+    }
+    const Value* find(uint64_t node, char c) const {
+        auto i = locate(make_key(node, c));
+        return i == capacity ? nullptr : &slots[i].value;
+    }
+
+    // insert the edge, or overwrite its value
+    void assign(uint64_t node, char c, Value value) {
+        auto i = locate(make_key(node, c));
+        if (i != capacity) {
+            slots[i].value = value;
+            return;
+        }
+        insert(node, c, value);
+    }
+
+    // insert an edge known to be absent, without probing for it first
+    void insert(uint64_t node, char c, Value value) {
+        auto key = make_key(node, c);
+        assert(locate(key) == capacity);
+        if ((double)(count + 1) > (double)capacity * max_load) rehash(std::max(min_capacity, 2 * capacity));
+        place({key, value});
+        count++;
+    }
+
+    bool erase(uint64_t node, char c) {
+        auto i = locate(make_key(node, c));
+        if (i == capacity) return false;
+        // shift the following entries of the cluster back by one, until one is at home
+        for (auto j = (i + 1) & (capacity - 1); slots[j].key != 0 && distance(j) > 0; j = (j + 1) & (capacity - 1)) {
+            slots[i] = slots[j];
+            i = j;
+        }
+        slots[i].key = 0;
+        count--;
+        return true;
+    }
+
+    // remove every edge, keeping the memory
+    void clear() {
+        for (size_t i = 0; i < capacity; i++) slots[i].key = 0;
+        count = 0;
+    }
+
+    // call f(node, character, value) for every edge, in no particular order
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t i = 0; i < capacity; i++) {
+            if (slots[i].key != 0) f((slots[i].key - 1) >> 8, (char)((slots[i].key - 1) & 0xff), slots[i].value);
+        }
+    }
+
+    size_t size() const { return count; }
+
+    void swap(EdgeTable& other) noexcept {
+        std::swap(policy, other.policy);
+        std::swap(slots, other.slots);
+        std::swap(capacity, other.capacity);
+        std::swap(count, other.count);
+        std::swap(shift, other.shift);
+    }
+
+    size_t size_in_bytes() const { return capacity * sizeof(Slot); }
+};
@@ -0,0 +1,226 @@
+#include "./enhanced_suffix_array.hpp"
+#include "./suffix_array.hpp"
+
+#include <assert.h>
+#include <algorithm> // std::count, std::min
+#include <fstream>
+#include <stdexcept>
+
+
+
+// ==========================================================================================
+//                                      child table
+// ==========================================================================================
+
+/*
+
+the child table of Abouelhoda et al., for an lcp-interval [i...j] with l-indices i1 < i2 < ... < ik
+(the positions where the LCP equals the depth of the interval, its children being [i...i1-1], [i1...i2-1], ..., [ik...j]):
+ - up[j+1] = down[i] = i1, the first l-index, stored as up[j+1] when [i...j] is the larger of the two
+   intervals that share it (lcp[j] > lcp[j+1]) and as down[i] otherwise;
+ - next_l_index[i_m] = i_{m+1}
+
+the three fields never collide: up[i] is stored in child[i-1], which is free since lcp[i-1] > lcp[i]
+means i-1 ends an interval and has neither a down nor a next l-index field,
+and a down field is only stored where there is no next l-index field;
+up[i] <= i-1 < down[i], next_l_index[i] and lcp[next_l_index[i]] = lcp[i] < lcp[down[i]], which tells them apart
+
+*/
+
+void EnhancedSuffixArray::build_child_table() {
+    auto n = (index_t)sa.size();
+    child.assign(n + 1, 0);
+
+    // up and down
+    std::vector<index_t> stack{0};
+    auto last = n; // none
+    for (index_t i = 1; i <= n; i++) {
+        while (lcp[i] < lcp[stack.back()]) {
+            last = stack.back();
+            stack.pop_back();
+            if (lcp[i] <= lcp[stack.back()] && lcp[stack.back()] != lcp[last]) child[stack.back()] = last;
+        }
+        if (last != n) {
+            child[i - 1] = last;
+            last = n;
+        }
+        stack.push_back(i);
+    }
+
+    // next l-index
+    stack = {0};
+    for (index_t i = 1; i <= n; i++) {
+        while (lcp[i] < lcp[stack.back()]) stack.pop_back();
+        if (lcp[i] == lcp[stack.back()]) {
+            child[stack.back()] = i;
+            stack.pop_back();
+        }
+        stack.push_back(i);
+    }
+}
+
+index_t EnhancedSuffixArray::first_l_index(const Interval& I) const {
+    // the root: the first position (after 0) with an LCP of 0
+    if (I.lb == 0 && I.rb + 1 == sa.size()) return next_l_index(0);
+    auto i = I.rb + 1;
+    if (lcp[i - 1] > lcp[i] && I.lb < up(i) && up(i) <= I.rb) return up(i);
+    return down(I.lb);
+}
+
+std::vector<EnhancedSuffixArray::Interval> EnhancedSuffixArray::children(const Interval& I) const {
+    std::vector<Interval> result;
+    auto depth = [this](index_t lb, index_t rb) {
+        return lb == rb ? (index_t)txt.size() - sa[lb] : lcp[first_l_index({lb, rb, 0})];
+    };
+    auto i = I.lb;
+    auto l = first_l_index(I);
+    do {
+        result.push_back({i, l - 1, depth(i, l - 1)});
+        i = l;
+        l = has_next_l_index(l) ? next_l_index(l) : I.rb + 1;
+    } while (i <= I.rb);
+    return result;
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+
+/*
+see SuffixTree::find_internal_node, the child of an interval starting with character c
+is found by a scan of its l-indices (at most sigma of them, read from consecutive entries of sa)
+*/
+std::pair<std::optional<EnhancedSuffixArray::Interval>, index_t> EnhancedSuffixArray::find_internal_node(std::string_view s) const {
+    Interval node{0, (index_t)sa.size() - 1, 0}; // start from the root
+    index_t i = 0; // at each iteration, search for s[i:]
+    while (true) {
+        // all characters in s have been matched: s exists and its is an internal node
+        if (i >= s.size()) return {node, i - (index_t)s.size()};
+
+        // the child interval [lb...l-1] whose suffixes continue with s[i]
+        auto lb = node.lb;
+        auto l = first_l_index(node);
+        while (txt[sa[lb] + i] != s[i]) {
+            // s doesn't exist
+            if (l > node.rb) return {std::nullopt, 0};
+            lb = l;
+            l = has_next_l_index(l) ? next_l_index(l) : node.rb + 1;
+        }
+        // s corresponds to an leaf node
+        if (lb == l - 1) return {std::nullopt, 1};
+
+        Interval child_node{lb, l - 1, lcp[first_l_index({lb, l - 1, 0})]};
+        // the number of characters need to be compared for this edge
+        auto len = std::min(child_node.depth, (index_t)s.size()) - i;
+        // mismatch: s doesn't exist
+        if (s.substr(i, len) != std::string_view(txt).substr(sa[lb] + i, len)) return {std::nullopt, 0};
+        node = child_node;
+        i = node.depth;
+    }
+    assert(false);
+}
+
+
+// compute the net frequency of a single substring s:
+// a leaf child [k...k] of S (suffix i = sa[k]) counts iff xS is unique (x = txt[i-1]),
+// i.e., iff suffix i-1 shares less than |S|+1 characters with both its neighbours in the suffix array
+index_t EnhancedSuffixArray::single_nf(std::string_view s) const {
+    auto [S, left_len_S] = find_internal_node(s);
+    // s doesn't exist, or is unique, or is non-branching
+    if (!S || left_len_S != 0) return 0;
+
+    index_t nf = 0;
+    auto k = S->lb;
+    auto l = first_l_index(*S);
+    while (k <= S->rb) {
+        if (k == l - 1) {
+            auto i = sa[k];
+            if (i == 0) {
+                nf++;
+            }
+            else {
+                auto row = isa[i - 1];
+                if (lcp[row] <= S->depth && lcp[row + 1] <= S->depth) nf++;
+            }
+        }
+        k = l;
+        l = has_next_l_index(l) ? next_l_index(l) : S->rb + 1;
+    }
+    return nf;
+}
+
+
+
+
+// ==========================================================================================
+//                                  other functions
+// ==========================================================================================
+
+
+// enhanced suffix array constructor, via a suffix array
+EnhancedSuffixArray::EnhancedSuffixArray(std::string_view _txt, unsigned threads) :
+    txt(_txt) {
+    assert(!txt.empty() && std::count(txt.begin(), txt.end(), txt.back()) == 1);
+    check_length(txt.size(), "EnhancedSuffixArray");
+    {
+        SuffixArray array{txt, threads};
+        sa = std::move(array.sa);
+        lcp = std::move(array.lcp);
+    }
+    lcp.push_back(0);
+    build_child_table();
+    isa.resize(sa.size());
+    for (index_t k = 0; k < sa.size(); k++) isa[sa[k]] = k;
+}
+
+template <typename T>
+static void write_vector(std::ofstream& out, const std::vector<T>& v) {
+    uint64_t size = v.size();
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(v.data()), (std::streamsize)(size * sizeof(T)));
+}
+
+template <typename T>
+static void read_vector(std::ifstream& in, std::vector<T>& v) {
+    uint64_t size = 0;
+    in.read(reinterpret_cast<char*>(&size), sizeof(size));
+    v.resize(size);
+    in.read(reinterpret_cast<char*>(v.data()), (std::streamsize)(size * sizeof(T)));
+}
+
+void EnhancedSuffixArray::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    std::vector<char> chars(txt.begin(), txt.end());
+    write_vector(out, chars);
+    write_vector(out, sa);
+    write_vector(out, lcp);
+    write_vector(out, child);
+    write_vector(out, isa);
+    if (!out) throw std::runtime_error("EnhancedSuffixArray: cannot write " + path);
+}
+
+EnhancedSuffixArray EnhancedSuffixArray::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("EnhancedSuffixArray: cannot open " + path);
+    EnhancedSuffixArray esa;
+    std::vector<char> chars;
+    read_vector(in, chars);
+    esa.txt.assign(chars.begin(), chars.end());
+    read_vector(in, esa.sa);
+    read_vector(in, esa.lcp);
+    read_vector(in, esa.child);
+    read_vector(in, esa.isa);
+    auto n = esa.txt.size();
+    if (!in || esa.sa.size() != n || esa.lcp.size() != n + 1 || esa.child.size() != n + 1 || esa.isa.size() != n) {
+        throw std::runtime_error("EnhancedSuffixArray: malformed file " + path);
+    }
+    return esa;
+}
+
+size_t EnhancedSuffixArray::size_in_bytes() const {
+    return txt.size() + (sa.size() + lcp.size() + child.size() + isa.size()) * sizeof(index_t);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <optional>
+#include <utility> // std::pair
+#include <cstdint>
+
+#include "./index.hpp"
+
+
+// an enhanced suffix array (Abouelhoda, Kurtz and Ohlebusch, "Replacing suffix trees with enhanced suffix arrays"):
+// the suffix array, the LCP array, the child table and the inverse suffix array as flat arrays,
+// the internal nodes of the suffix tree being the lcp-intervals [lb...rb]
+class EnhancedSuffixArray {
+private:
+    std::string txt;
+    // as in SuffixArray, with a sentinel lcp[n] = 0
+    std::vector<index_t> sa, lcp;
+    // the up, down and next l-index fields of the child table, folded into a single array
+    std::vector<index_t> child;
+    // isa[sa[k]] = k
+    std::vector<index_t> isa;
+
+    EnhancedSuffixArray() {}
+    void build_child_table();
+    index_t up(index_t i) const { return child[i - 1]; }
+    index_t down(index_t i) const { return child[i]; }
+    index_t next_l_index(index_t i) const { return child[i]; }
+    bool has_next_l_index(index_t i) const { return child[i] > i && lcp[child[i]] == lcp[i]; }
+
+public:
+    struct Interval {
+        index_t lb, rb, depth;
+    };
+
+    // constructor, the text must end with a unique terminator
+    EnhancedSuffixArray(std::string_view _txt, unsigned threads = 0);
+
+    // the first l-index of a (non-singleton) interval, i.e., where its second child starts
+    index_t first_l_index(const Interval& I) const;
+    // the children of an interval, in order
+    std::vector<Interval> children(const Interval& I) const;
+
+    // see SuffixTree::find_internal_node
+    std::pair<std::optional<Interval>, index_t> find_internal_node(std::string_view s) const;
+
+    index_t single_nf(std::string_view s) const;
+
+    // the arrays are written as they are, preceded by their length
+    // (so a file is only read back by a build with the same index_t)
+    void save(const std::string& path) const;
+    static EnhancedSuffixArray load(const std::string& path);
+
+    std::string_view text() const { return txt; }
+    size_t size_in_bytes() const;
+};
@@ -0,0 +1,558 @@
+#include "./external_nf.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <algorithm> // std::sort, std::clamp
+#include <memory> // std::unique_ptr
+#include <queue> // std::priority_queue
+#include <stdexcept>
+#include <cstring> // std::memcpy
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+// ==========================================================================================
+//                                  buffered files
+// ==========================================================================================
+
+ExternalNF::File::File(std::string _path, const char* mode, size_t buffer_size, uint64_t* _counter) :
+    file(std::fopen(_path.c_str(), mode)),
+    buffer(buffer_size),
+    pos(0),
+    end(0),
+    writing(mode[0] == 'w'),
+    counter(_counter),
+    path(std::move(_path)) {
+    if (file == nullptr) {
+        throw std::runtime_error("ExternalNF: cannot open " + path);
+    }
+}
+
+ExternalNF::File::~File() {
+    flush();
+    std::fclose(file);
+}
+
+void ExternalNF::File::write(const void* data, size_t size) {
+    if (pos + size > buffer.size()) flush();
+    if (size > buffer.size()) {
+        // (a block larger than the buffer, e.g. a whole sorted run, goes straight to the file)
+        if (std::fwrite(data, 1, size, file) != size) {
+            throw std::runtime_error("ExternalNF: cannot write " + path);
+        }
+        *counter += size;
+        return;
+    }
+    std::memcpy(buffer.data() + pos, data, size);
+    pos += size;
+}
+
+bool ExternalNF::File::read(void* data, size_t size) {
+    if (pos + size > end) {
+        // keep the unread bytes and refill the rest of the buffer
+        std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+        end -= pos;
+        pos = 0;
+        auto got = std::fread(buffer.data() + end, 1, buffer.size() - end, file);
+        *counter += got;
+        end += got;
+        if (size > end) return false;
+    }
+    std::memcpy(data, buffer.data() + pos, size);
+    pos += size;
+    return true;
+}
+
+void ExternalNF::File::flush() {
+    if (writing && pos > 0) {
+        if (std::fwrite(buffer.data(), 1, pos, file) != pos) {
+            throw std::runtime_error("ExternalNF: cannot write " + path);
+        }
+        *counter += pos;
+        pos = 0;
+    }
+}
+
+/*
+a stack whose bottom moves to a file once the part in memory reaches `capacity` records (half of them at a time),
+and comes back half a capacity at a time once the part in memory runs out, so that the top is always in memory
+(the stack of all_nf is as high as the longest repeat is long, e.g. n for a^n)
+*/
+template <typename Record>
+class SpilledStack {
+private:
+    std::vector<Record> top;
+    size_t capacity;
+    std::string path;
+    std::FILE* file;
+    // the number of records in the file
+    size_t spilled;
+    uint64_t* read_counter;
+    uint64_t* write_counter;
+
+public:
+    SpilledStack(size_t _capacity, std::string _path, uint64_t* _read_counter, uint64_t* _write_counter) :
+        capacity(std::max<size_t>(_capacity, 2)),
+        path(std::move(_path)),
+        file(nullptr),
+        spilled(0),
+        read_counter(_read_counter),
+        write_counter(_write_counter) {
+        top.reserve(capacity);
+    }
+    ~SpilledStack() {
+        if (file != nullptr) {
+            std::fclose(file);
+            std::remove(path.c_str());
+        }
+    }
+    SpilledStack(const SpilledStack&) = delete;
+    SpilledStack& operator=(const SpilledStack&) = delete;
+
+    Record& back() { return top.back(); }
+
+    void push(Record record) {
+        if (top.size() == capacity) {
+            if (file == nullptr && (file = std::fopen(path.c_str(), "w+b")) == nullptr) {
+                throw std::runtime_error("ExternalNF: cannot open " + path);
+            }
+            auto half = capacity / 2;
+            std::fseek(file, (long)(spilled * sizeof(Record)), SEEK_SET);
+            if (std::fwrite(top.data(), sizeof(Record), half, file) != half) {
+                throw std::runtime_error("ExternalNF: cannot write " + path);
+            }
+            *write_counter += half * sizeof(Record);
+            spilled += half;
+            top.erase(top.begin(), top.begin() + (std::ptrdiff_t)half);
+        }
+        top.push_back(record);
+    }
+
+    void pop() {
+        top.pop_back();
+        if (top.empty() && spilled > 0) {
+            auto count = std::min(spilled, capacity / 2);
+            spilled -= count;
+            top.resize(count);
+            std::fseek(file, (long)(spilled * sizeof(Record)), SEEK_SET);
+            if (std::fread(top.data(), sizeof(Record), count, file) != count) {
+                throw std::runtime_error("ExternalNF: cannot read " + path);
+            }
+            *read_counter += count * sizeof(Record);
+        }
+    }
+};
+
+
+
+
+// ==========================================================================================
+//                                  external merge sort
+// ==========================================================================================
+
+/*
+sorted runs of as many records as fit in half of the budget, then merged `fan_in` runs at a time,
+in as many passes as it takes: the buffers of a merge share a quarter of the budget, at least a page each
+*/
+
+std::string ExternalNF::path(const std::string& name, size_t i) const {
+    return dir + "/" + name + "." + std::to_string(i);
+}
+
+// a new file name in the working directory
+std::string ExternalNF::temporary() {
+    return path("tmp", temporaries++);
+}
+
+// the buffer size of each of `files` files open at once (a quarter of the budget shared among them)
+size_t ExternalNF::buffer_size(size_t files) const {
+    return std::clamp<size_t>(budget / 4 / std::max<size_t>(files, 1), 4096, 1 << 20);
+}
+
+template <typename Record, typename Less>
+void ExternalNF::sort(const std::string& in, const std::string& out, Less less) {
+    std::vector<std::string> runs;
+    {
+        std::vector<Record> records;
+        records.reserve(std::max<size_t>(1, budget / 2 / sizeof(Record)));
+        File input(in, "rb", buffer_size(2), &bytes_read);
+        for (bool more = true; more;) {
+            records.clear();
+            Record record;
+            while (records.size() < records.capacity() && (more = input.read(&record, sizeof(record)))) {
+                records.push_back(record);
+            }
+            if (records.empty()) break;
+            std::sort(records.begin(), records.end(), less);
+            runs.push_back(temporary());
+            File run(runs.back(), "wb", buffer_size(2), &bytes_written);
+            run.write(records.data(), records.size() * sizeof(Record));
+        }
+    }
+    std::remove(in.c_str());
+
+    size_t fan_in = std::max<size_t>(2, budget / 4 / 4096 - 1);
+    while (runs.size() > 1) {
+        std::vector<std::string> merged;
+        for (size_t first = 0; first < runs.size(); first += fan_in) {
+            auto last = std::min(runs.size(), first + fan_in);
+            // (the last merge writes the output)
+            merged.push_back(runs.size() <= fan_in ? out : temporary());
+            File output(merged.back(), "wb", buffer_size(last - first + 1), &bytes_written);
+            std::vector<std::unique_ptr<File>> inputs;
+            using Head = std::pair<Record, size_t>;
+            auto later = [&less](const Head& a, const Head& b) { return less(b.first, a.first); };
+            std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+            for (auto r = first; r < last; r++) {
+                inputs.push_back(std::make_unique<File>(runs[r], "rb", buffer_size(last - first + 1), &bytes_read));
+                Record record;
+                if (inputs.back()->read(&record, sizeof(record))) heads.push({record, r - first});
+            }
+            while (!heads.empty()) {
+                auto [record, r] = heads.top();
+                heads.pop();
+                output.write(&record, sizeof(record));
+                if (inputs[r]->read(&record, sizeof(record))) heads.push({record, r});
+            }
+            for (auto r = first; r < last; r++) std::remove(runs[r].c_str());
+        }
+        runs = std::move(merged);
+    }
+    if (runs.empty()) File(out, "wb", buffer_size(1), &bytes_written);
+    else if (runs.front() != out) std::rename(runs.front().c_str(), out.c_str());
+}
+
+
+
+
+// ==========================================================================================
+//                          external suffix array and LCP array
+// ==========================================================================================
+
+/*
+
+suffix sorting by prefix doubling (every step a scan or an external sort):
+ - the ranks of the suffixes by their first character, in text order;
+ - in the round of h, the ranks are scanned twice at once, h records apart, giving (rank[i], rank[i+h], i),
+   these are sorted, and the new rank of a suffix is the number of suffixes before it
+   with a smaller pair (so that once they are all distinct, the sorted order is the suffix array),
+   the new ranks are then sorted back into text order for the next round;
+ - the rounds stop once the ranks are all distinct (after log2 of the longest repeat rounds)
+
+the LCP array is computed from the ranks of the rounds rather than from the text (which would take random reads):
+the ranks of two suffixes at the round of h are equal iff their first h characters are, so the LCP of each suffix
+with the one before it in the suffix array is found by binary lifting, from the last round down to the first:
+ - every pair (a = sa[k], b = sa[k-1]) starts with l = 0;
+ - at the round of h, the pairs are sorted by a + l and joined with the ranks of that round (a scan in text order),
+   then sorted by b + l and joined again, and l grows by h where the two ranks are equal;
+ - the pairs are sorted back into suffix array order
+(two sorts per round, and the ranks of all rounds stay on disk until then: 4n bytes per round)
+
+(resources: Crauser and Ferragina, "A theoretical and experimental study on the construction of suffix arrays
+ in external memory")
+*/
+
+void ExternalNF::build() {
+    struct Pair {
+        index_t i, rank;
+    };
+    struct Triple {
+        index_t first, second, i;
+    };
+
+    auto ranks = temporary();
+    // (the ranks of every round are kept for the LCP array)
+    std::vector<std::string> levels{ranks};
+    {
+        File text_file(text_path, "rb", buffer_size(2), &text_bytes);
+        File rank_file(ranks, "wb", buffer_size(2), &bytes_written);
+        char c;
+        while (text_file.read(&c, 1)) {
+            // (0 is left for the end of the text, so that a shorter suffix sorts first)
+            index_t rank = (unsigned char)c + 1;
+            rank_file.write(&rank, sizeof(rank));
+        }
+    }
+
+    for (index_t h = 1;; h *= 2) {
+        auto triples = temporary(), sorted = temporary();
+        {
+            File rank_file(ranks, "rb", buffer_size(3), &bytes_read);
+            File ahead(ranks, "rb", buffer_size(3), &bytes_read);
+            File triple_file(triples, "wb", buffer_size(3), &bytes_written);
+            index_t rank, skipped;
+            for (index_t i = 0; i < h && ahead.read(&skipped, sizeof(skipped)); i++) {}
+            for (index_t i = 0; rank_file.read(&rank, sizeof(rank)); i++) {
+                Triple triple{rank, 0, i};
+                if (!ahead.read(&triple.second, sizeof(triple.second))) triple.second = 0;
+                triple_file.write(&triple, sizeof(triple));
+            }
+        }
+        sort<Triple>(triples, sorted, [](const Triple& a, const Triple& b) {
+            return a.first != b.first ? a.first < b.first : a.second < b.second;
+        });
+
+        // the new ranks (1-based), in suffix array order
+        auto pairs = temporary();
+        index_t distinct = 0;
+        {
+            File sorted_file(sorted, "rb", buffer_size(2), &bytes_read);
+            File pair_file(pairs, "wb", buffer_size(2), &bytes_written);
+            Triple triple, last{0, 0, 0};
+            index_t rank = 0;
+            for (index_t k = 0; sorted_file.read(&triple, sizeof(triple)); k++) {
+                if (k == 0 || triple.first != last.first || triple.second != last.second) {
+                    rank = k + 1;
+                    distinct++;
+                }
+                Pair pair{triple.i, rank};
+                pair_file.write(&pair, sizeof(pair));
+                last = triple;
+            }
+        }
+        std::remove(sorted.c_str());
+
+        if (distinct == n || h >= n) {
+            // the suffix array is the order of the pairs
+            File pair_file(pairs, "rb", buffer_size(2), &bytes_read);
+            File sa_file(path("sa"), "wb", buffer_size(2), &bytes_written);
+            Pair pair;
+            while (pair_file.read(&pair, sizeof(pair))) sa_file.write(&pair.i, sizeof(pair.i));
+            std::remove(pairs.c_str());
+            break;
+        }
+
+        auto by_position = temporary();
+        sort<Pair>(pairs, by_position, [](const Pair& a, const Pair& b) { return a.i < b.i; });
+        ranks = temporary();
+        levels.push_back(ranks);
+        File pair_file(by_position, "rb", buffer_size(2), &bytes_read);
+        File rank_file(ranks, "wb", buffer_size(2), &bytes_written);
+        Pair pair;
+        while (pair_file.read(&pair, sizeof(pair))) rank_file.write(&pair.rank, sizeof(pair.rank));
+        std::remove(by_position.c_str());
+    }
+
+    build_lcp(levels);
+}
+
+void ExternalNF::build_lcp(const std::vector<std::string>& levels) {
+    // the suffixes a = sa[k] and b = sa[k-1] agree on their first l characters,
+    // and ra is the rank of the suffix a + l at the current level (0 past the end of the text)
+    struct Probe {
+        index_t k, a, b, l, ra;
+    };
+
+    auto probes = temporary();
+    {
+        File sa_file(path("sa"), "rb", buffer_size(2), &bytes_read);
+        File probe_file(probes, "wb", buffer_size(2), &bytes_written);
+        index_t i, prev = 0;
+        for (index_t k = 0; sa_file.read(&i, sizeof(i)); k++) {
+            Probe probe{k, i, prev, 0, 0};
+            if (k > 0) probe_file.write(&probe, sizeof(probe));
+            prev = i;
+        }
+    }
+
+    // join each probe with the rank of position (a + l or b + l) in the level file, in the order of that position
+    auto join = [this](const std::string& in, const std::string& out, const std::string& level, auto position, auto f) {
+        File probe_file(in, "rb", buffer_size(3), &bytes_read);
+        File rank_file(level, "rb", buffer_size(3), &bytes_read);
+        File out_file(out, "wb", buffer_size(3), &bytes_written);
+        Probe probe;
+        index_t pos = 0, rank = 0;
+        bool more = rank_file.read(&rank, sizeof(rank));
+        while (probe_file.read(&probe, sizeof(probe))) {
+            auto p = position(probe);
+            while (more && pos < p) {
+                more = rank_file.read(&rank, sizeof(rank));
+                pos++;
+            }
+            f(probe, p < n ? rank : 0);
+            out_file.write(&probe, sizeof(probe));
+        }
+    };
+
+    for (auto level = levels.size(); level-- > 0;) {
+        auto h = (index_t)1 << level;
+        auto by_a = temporary(), with_a = temporary(), by_b = temporary();
+        sort<Probe>(probes, by_a, [](const Probe& x, const Probe& y) { return x.a + x.l < y.a + y.l; });
+        join(by_a, with_a, levels[level], [](const Probe& probe) { return probe.a + probe.l; },
+             [](Probe& probe, index_t rank) { probe.ra = rank; });
+        std::remove(by_a.c_str());
+        sort<Probe>(with_a, by_b, [](const Probe& x, const Probe& y) { return x.b + x.l < y.b + y.l; });
+        probes = temporary();
+        join(by_b, probes, levels[level], [](const Probe& probe) { return probe.b + probe.l; },
+             [h](Probe& probe, index_t rank) {
+                 if (probe.ra != 0 && rank == probe.ra) probe.l += h;
+             });
+        std::remove(by_b.c_str());
+        std::remove(levels[level].c_str());
+    }
+
+    auto by_rank = temporary();
+    sort<Probe>(probes, by_rank, [](const Probe& x, const Probe& y) { return x.k < y.k; });
+    File probe_file(by_rank, "rb", buffer_size(2), &bytes_read);
+    File lcp_file(path("lcp"), "wb", buffer_size(2), &bytes_written);
+    index_t lcp = 0;
+    if (n > 0) lcp_file.write(&lcp, sizeof(lcp));
+    Probe probe;
+    while (probe_file.read(&probe, sizeof(probe))) lcp_file.write(&probe.l, sizeof(probe.l));
+    std::remove(by_rank.c_str());
+}
+
+ExternalNF::ExternalNF(const std::string& _text_path, const std::string& work_dir, size_t memory_budget) :
+    text_path(_text_path),
+    fd(-1),
+    n(0),
+    dir(work_dir),
+    budget(memory_budget),
+    temporaries(0),
+    bytes_read(0),
+    bytes_written(0),
+    text_bytes(0) {
+    if (budget < min_budget) {
+        throw std::invalid_argument("ExternalNF: the memory budget must be at least " + std::to_string(min_budget) + " bytes");
+    }
+    fd = open(text_path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("ExternalNF: cannot open " + text_path);
+    struct stat st;
+    fstat(fd, &st);
+    try {
+        n = (index_t)check_length((size_t)st.st_size, "ExternalNF");
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+
+    build();
+}
+
+ExternalNF::~ExternalNF() {
+    std::remove(path("sa").c_str());
+    std::remove(path("lcp").c_str());
+    close(fd);
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+/*
+
+the same sweep over the lcp-intervals as SuffixArray::all_nf,
+where the k-th suffix i = sa[k] is a leaf child of the interval of depth m(i) = max(lcp[k], lcp[k+1])
+and counts towards its net frequency iff m(i-1) <= m(i)
+
+m(i-1) is needed in suffix array order, so it is brought there by two external sorts:
+ - (suffix array order) write (i, m(i), k), and sort these by i;
+ - (text order) write (k, m(i-1)) for each, and sort these by k;
+ - (suffix array order) sweep, reading m(i-1) alongside the suffix array and the LCP array
+*/
+
+void ExternalNF::all_nf() {
+    if (n == 0) return;
+
+    // stream the suffix array with the next LCP value: f(k, sa[k], lcp[k], lcp[k+1])
+    // (`extra` more files are open meanwhile)
+    auto stream = [this](size_t extra, auto f) {
+        File sa_file(path("sa"), "rb", buffer_size(2 + extra), &bytes_read);
+        File lcp_file(path("lcp"), "rb", buffer_size(2 + extra), &bytes_read);
+        index_t i, lcp, next = 0;
+        sa_file.read(&i, sizeof(i));
+        lcp_file.read(&lcp, sizeof(lcp));
+        for (index_t k = 0; k < n; k++) {
+            if (k + 1 < n) lcp_file.read(&next, sizeof(next));
+            else next = 0;
+            f(k, i, lcp, next);
+            sa_file.read(&i, sizeof(i));
+            lcp = next;
+        }
+    };
+
+    struct Triple {
+        index_t i, m, k;
+    };
+    struct Pair {
+        index_t k, m;
+    };
+    auto triples = temporary(), by_position = temporary();
+    {
+        File triple_file(triples, "wb", buffer_size(3), &bytes_written);
+        stream(1, [&](index_t k, index_t i, index_t lcp, index_t next) {
+            Triple triple{i, std::max(lcp, next), k};
+            triple_file.write(&triple, sizeof(triple));
+        });
+    }
+    sort<Triple>(triples, by_position, [](const Triple& a, const Triple& b) { return a.i < b.i; });
+
+    auto pairs = temporary(), by_rank = temporary();
+    {
+        File triple_file(by_position, "rb", buffer_size(2), &bytes_read);
+        File pair_file(pairs, "wb", buffer_size(2), &bytes_written);
+        // the suffix 0 has no preceding suffix and always counts
+        index_t prev = 0;
+        Triple triple;
+        while (triple_file.read(&triple, sizeof(triple))) {
+            Pair pair{triple.k, prev};
+            pair_file.write(&pair, sizeof(pair));
+            prev = triple.m;
+        }
+    }
+    std::remove(by_position.c_str());
+    sort<Pair>(pairs, by_rank, [](const Pair& a, const Pair& b) { return a.k < b.k; });
+
+    struct Interval {
+        index_t lcp, start, nf;
+    };
+    // (the stack takes a quarter of the budget, the files and the output another one)
+    SpilledStack<Interval> stack(budget / 4 / sizeof(Interval), temporary(), &bytes_read, &bytes_written);
+    stack.push({0, 0, 0});
+    std::vector<char> piece(buffer_size(4));
+    {
+        File prev_file(by_rank, "rb", buffer_size(4), &bytes_read);
+        stream(2, [&](index_t, index_t i, index_t lcp, index_t next) {
+            Pair prev;
+            prev_file.read(&prev, sizeof(prev));
+            auto m = std::max(lcp, next);
+            index_t nf = prev.m <= m;
+
+            // as in SuffixArray::all_nf, with the boundary to the next suffix
+            auto start = i;
+            if (next <= stack.back().lcp) {
+                stack.back().nf += nf;
+                nf = 0;
+            }
+            while (next < stack.back().lcp) {
+                auto S = stack.back();
+                stack.pop();
+                if (S.nf) {
+                    // (a long string is printed in pieces of the size of a file buffer)
+                    for (index_t done = 0; done < S.lcp;) {
+                        auto size = std::min<size_t>(S.lcp - done, piece.size());
+                        if (pread(fd, piece.data(), size, (off_t)(S.start + done)) != (ssize_t)size) {
+                            throw std::runtime_error("ExternalNF: cannot read " + text_path);
+                        }
+                        text_bytes += size;
+                        std::cout.write(piece.data(), (std::streamsize)size);
+                        done += (index_t)size;
+                    }
+                    std::cout << '\t' << S.nf << std::endl;
+                }
+                start = S.start;
+            }
+            if (next > stack.back().lcp) {
+                stack.push({next, start, nf});
+            }
+        });
+    }
+    std::remove(by_rank.c_str());
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+#include "./index.hpp"
+
+
+// net frequencies of a disk-resident text within a memory budget:
+// the suffix array and LCP array are built on disk, and all_nf streams through them
+// (every step is a scan or an external merge sort of fixed-size records, the text is scanned once and then only read
+//  for the output of all_nf, and the stack of all_nf spills to disk, so the memory in use stays within the budget
+//  whatever the text; positions are index_t, see check_length)
+class ExternalNF {
+public:
+    // a file of fixed-size records, written and read sequentially through a buffer,
+    // the number of bytes moved to/from disk is added to the owner's counters
+    class File {
+    private:
+        std::FILE* file;
+        std::vector<char> buffer;
+        size_t pos, end;
+        bool writing;
+        uint64_t* counter;
+
+    public:
+        std::string path;
+
+        File(std::string _path, const char* mode, size_t buffer_size, uint64_t* _counter);
+        ~File();
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        void write(const void* data, size_t size);
+        // returns false at the end of the file
+        bool read(void* data, size_t size);
+        void flush();
+    };
+
+private:
+    // the input text, scanned once by the construction, all_nf then reads each string it prints
+    std::string text_path;
+    int fd;
+    index_t n;
+    // where the temporary files go
+    std::string dir;
+    size_t budget;
+
+    // the number of temporary files named so far (see `temporary`)
+    size_t temporaries;
+
+    std::string path(const std::string& name, size_t i = 0) const;
+    std::string temporary();
+    size_t buffer_size(size_t files) const;
+
+    // sort the records of the file `in` into the file `out` (removing `in`)
+    template <typename Record, typename Less>
+    void sort(const std::string& in, const std::string& out, Less less);
+
+    void build();
+    // levels[j] = the file of the ranks (in text order) of the prefixes of length 2^j of the suffixes
+    void build_lcp(const std::vector<std::string>& levels);
+
+public:
+    // the smallest memory budget: a merge needs a few buffers of a page or more
+    static constexpr size_t min_budget = (size_t)64 << 10;
+
+    // I/O volume in bytes, and the number of bytes read from the text file
+    // (by the construction's scan, and by all_nf for the strings it prints)
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t text_bytes;
+
+    // constructor: builds the suffix array and the LCP array of the text in `text_path`
+    // as files in `work_dir`, using at most about `memory_budget` bytes of memory
+    // (throws std::invalid_argument if the budget is below min_budget)
+    ExternalNF(const std::string& text_path, const std::string& work_dir, size_t memory_budget);
+    ~ExternalNF();
+
+    // compute and print the net frequencies of all the branching substrings
+    void all_nf();
+};
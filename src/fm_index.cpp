@@ -0,0 +1,164 @@
+#include "./fm_index.hpp"
+#include "./suffix_array.hpp"
+#include "./index.hpp"
+
+#include <assert.h>
+#include <bit> // std::popcount
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+
+// ==========================================================================================
+//                                  blocked BWT
+// ==========================================================================================
+
+FMIndex::BWT::BWT(std::string_view bwt, uint32_t primary, char last, const FMIndex& index) :
+    rows((uint32_t)bwt.size() + 1),
+    terminator_row(primary + 1),
+    C(257, 0) {
+    auto sigma = index.alphabet.size();
+    auto blocks = (rows + block - 1) / block;
+    // one spare block of padding, so that a 16-byte load never reads past the end
+    chars.assign((size_t)(blocks + 1) * block, '\0');
+    chars[0] = last;
+    for (uint32_t k = 0; k < bwt.size(); k++) chars[k + 1] = bwt[k];
+
+    counts.assign((size_t)(blocks + 1) * sigma, 0);
+    std::vector<uint32_t> count(256, 0);
+    // (rank may be asked at k = rows, which can start a block of its own)
+    for (uint32_t k = 0; k <= rows; k++) {
+        if (k % block == 0) {
+            for (size_t a = 0; a < sigma; a++) counts[k / block * sigma + a] = count[index.alphabet[a]];
+        }
+        if (k < rows && k != terminator_row) count[(unsigned char)chars[k]]++;
+    }
+
+    C[0] = 1;
+    for (size_t c = 0; c < 256; c++) C[c + 1] = C[c] + count[c];
+}
+
+// the count of the block, plus the c's in the block before k, 16 bytes per comparison
+uint32_t FMIndex::BWT::rank(unsigned char c, uint32_t k, const FMIndex& index) const {
+    auto b = k / block;
+    auto r = counts[b * index.alphabet.size() + (size_t)index.code[c]];
+    auto p = b * block;
+#ifdef __SSE2__
+    auto x = _mm_set1_epi8((char)c);
+    for (; p < k; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars.data() + p));
+        auto mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, x));
+        if (k - p < 16) mask &= ((uint32_t)1 << (k - p)) - 1;
+        r += (uint32_t)std::popcount(mask);
+    }
+#else
+    for (; p < k; p++) r += (unsigned char)chars[p] == c;
+#endif
+    // (the placeholder is left out of the block counts, so it is only discounted within the block)
+    if (c == 0 && terminator_row >= b * block && terminator_row < k) r--;
+    return r;
+}
+
+size_t FMIndex::BWT::size_in_bytes() const {
+    return chars.size() + (counts.size() + C.size()) * sizeof(uint32_t);
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+/*
+compute the net frequency of a single substring s, as in RIndex::single_nf:
+ - backward search for s in the forward BWT and for rev(s) in the reverse BWT;
+ - the reverse BWT rows of S count its right extensions Sy (the rows of S followed by the end of the text first),
+   S is branching iff there are two of them, and they split the forward rows of S in order;
+ - a unique right extension Sy (a single forward row k) counts iff its left extension x = bwt[k] is unique as well,
+   i.e., occurs once in the forward rows of S (or is the terminator: the occurrence at position 0)
+*/
+uint32_t FMIndex::single_nf(std::string_view s) const {
+    uint32_t l = 0, r = forward.rows, rl = 0, rr = reverse.rows;
+    for (auto c = s.rbegin(); c != s.rend() && l < r; c++) {
+        auto x = (unsigned char)*c;
+        // s doesn't exist
+        if (code[x] < 0) return 0;
+        l = forward.C[x] + forward.rank(x, l, *this);
+        r = forward.C[x] + forward.rank(x, r, *this);
+    }
+    // s doesn't exist, or is unique
+    if (r <= l + 1) return 0;
+    for (auto c = s.begin(); c != s.end(); c++) {
+        auto x = (unsigned char)*c;
+        rl = reverse.C[x] + reverse.rank(x, rl, *this);
+        rr = reverse.C[x] + reverse.rank(x, rr, *this);
+    }
+    assert(rr - rl == r - l);
+
+    // the right extensions
+    auto k = l;
+    uint32_t extensions = 0;
+    if (reverse.terminator_row >= rl && reverse.terminator_row < rr) {
+        extensions++;
+        k++;
+    }
+    std::vector<uint32_t> unique;
+    for (auto y : alphabet) {
+        auto size = reverse.rank(y, rr, *this) - reverse.rank(y, rl, *this);
+        if (size > 0) extensions++;
+        if (size == 1) unique.push_back(k);
+        k += size;
+    }
+    // s is non-branching
+    if (extensions < 2) return 0;
+
+    uint32_t nf = 0;
+    for (auto row : unique) {
+        if (row == forward.terminator_row) {
+            nf++;
+            continue;
+        }
+        auto x = (unsigned char)forward.chars[row];
+        if (forward.rank(x, r, *this) - forward.rank(x, l, *this) == 1) nf++;
+    }
+    return nf;
+}
+
+
+
+
+// ==========================================================================================
+//                                  other functions
+// ==========================================================================================
+
+
+// FM-index constructor, the suffix array of one direction is released before the other one is built
+FMIndex::FMIndex(std::string_view txt, unsigned threads) {
+    check_length32(txt.size(), "FMIndex");
+    code.fill(-1);
+    for (auto c : txt) code[(unsigned char)c] = 0;
+    for (size_t c = 0; c < 256; c++) {
+        if (code[c] == 0) {
+            code[c] = (int16_t)alphabet.size();
+            alphabet.push_back((unsigned char)c);
+        }
+    }
+    if (txt.empty()) return;
+
+    {
+        SuffixArray sa{txt, threads};
+        forward = BWT(sa.bwt, (uint32_t)sa.primary, txt.back(), *this);
+    }
+    std::string reversed(txt.rbegin(), txt.rend());
+    {
+        SuffixArray sa{reversed, threads};
+        reverse = BWT(sa.bwt, (uint32_t)sa.primary, reversed.back(), *this);
+    }
+}
+
+size_t FMIndex::size_in_bytes() const {
+    return forward.size_in_bytes() + reverse.size_in_bytes() + alphabet.size() + sizeof(code);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+
+// a bidirectional FM-index: the BWTs of the text and of the reversed text with blocked occurrence counts,
+// enough to answer single_nf without a suffix tree (the text itself is not kept)
+class FMIndex {
+private:
+    // a BWT with n+1 rows (row 0 being the empty suffix), where the row of suffix 0
+    // (whose preceding character is the virtual terminator) holds a placeholder '\0' that rank() discounts
+    class BWT {
+    public:
+        static constexpr uint32_t block = 64;
+
+        // padded to a whole number of blocks
+        std::string chars;
+        uint32_t rows, terminator_row;
+        // counts[b * sigma + code[c]] = the number of c's before the b-th block
+        std::vector<uint32_t> counts;
+        // C[c] = the number of rows whose suffix starts with a character smaller than c (the empty one included)
+        std::vector<uint32_t> C;
+
+        BWT() : rows(0), terminator_row(0) {}
+        // `bwt` and `primary` as in SuffixArray, `last` = the last character of the text
+        BWT(std::string_view bwt, uint32_t primary, char last, const FMIndex& index);
+
+        // the number of c's in rows [0, k), c must occur in the text
+        uint32_t rank(unsigned char c, uint32_t k, const FMIndex& index) const;
+
+        size_t size_in_bytes() const;
+    };
+
+    BWT forward, reverse;
+    // the characters of the text in increasing order, and their rank among them
+    std::vector<unsigned char> alphabet;
+    std::array<int16_t, 256> code;
+
+public:
+    // constructor, via two (temporary) suffix arrays (32-bit positions, see check_length32 in index.hpp)
+    FMIndex(std::string_view txt, unsigned threads = 0);
+
+    uint32_t single_nf(std::string_view s) const;
+
+    size_t size_in_bytes() const;
+};
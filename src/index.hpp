@@ -0,0 +1,35 @@
+#pragma once
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+// the type of text positions (and of every quantity bounded by the text length):
+// 32 bits by default, 64 bits when compiled with -DNF_INDEX64 for texts of 4 GiB and more
+#ifdef NF_INDEX64
+using index_t = uint64_t;
+#else
+using index_t = uint32_t;
+#endif
+
+// text positions (and the one-past-the-end position) must fit in index_t (returns n, for use in initializer lists)
+inline size_t check_length(size_t n, const char* who) {
+    if (n >= std::numeric_limits<index_t>::max()) {
+        throw std::length_error(std::string(who) + ": the text is too long for " + std::to_string(sizeof(index_t) * 8)
+                                + "-bit positions (compile with -DNF_INDEX64)");
+    }
+    return n;
+}
+
+// the same for the structures that only support 32-bit positions, whatever index_t is
+// (FMIndex, RIndex, CompressedSuffixTree and LazySuffixTree: their constructors throw std::length_error
+//  for a text of 4 GiB or more)
+inline size_t check_length32(size_t n, const char* who) {
+    if (n >= std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error(std::string(who) + ": the text is too long for 32-bit positions");
+    }
+    return n;
+}
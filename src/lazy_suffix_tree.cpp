@@ -0,0 +1,173 @@
+#include "./lazy_suffix_tree.hpp"
+#include "./index.hpp"
+
+#include <assert.h>
+#include <algorithm> // std::sort, std::min
+#include <numeric> // std::iota
+
+
+
+// ==========================================================================================
+//                                  lazy expansion related
+// ==========================================================================================
+
+/*
+
+high-level idea (Giegerich, Kurtz and Stoye, "Efficient implementation of lazy suffix trees"):
+ - every node owns a contiguous range of `suffixes`, initially the root owns all of them unsorted;
+ - expanding a node of string depth d sorts its range by the (d+1)-th character of each suffix,
+   a group of one suffix is a leaf, and a group of two or more suffixes is extended
+   character by character while all its suffixes agree, which gives the depth of the child;
+ - the child is left unexpanded, it will only sort its own range when a query reaches it
+
+a query therefore costs the size of the ranges of the nodes it expands,
+the first query expands the root (a linear counting sort) and every later query gets cheaper
+*/
+
+void LazySuffixTree::expand(Node* node) {
+    if (node->expanded) return;
+    node->expanded = true;
+
+    auto n = (uint32_t)txt.size();
+    auto d = node->depth;
+    auto lo = node->lo, hi = node->hi;
+
+    // sort the range by the (d+1)-th character, which is read from the text only once per suffix:
+    // a counting sort for large ranges, a comparison sort for small ones
+    keys.resize(hi - lo);
+    for (auto k = lo; k < hi; k++) keys[k - lo] = (unsigned char)txt[suffixes[k] + d];
+    if (hi - lo > 256) {
+        std::vector<uint32_t> count(257, 0);
+        for (auto key : keys) count[key + 1]++;
+        for (size_t a = 1; a < count.size(); a++) count[a] += count[a - 1];
+        buffer.resize(hi - lo);
+        for (auto k = lo; k < hi; k++) buffer[count[keys[k - lo]]++] = suffixes[k];
+        std::copy(buffer.begin(), buffer.end(), suffixes.begin() + lo);
+        std::sort(keys.begin(), keys.end());
+    }
+    else {
+        std::sort(suffixes.begin() + lo, suffixes.begin() + hi, [this, d](uint32_t a, uint32_t b) {
+            return (unsigned char)txt[a + d] < (unsigned char)txt[b + d];
+        });
+        std::sort(keys.begin(), keys.end());
+    }
+
+    for (auto a = lo; a < hi;) {
+        auto b = a + 1;
+        while (b < hi && keys[b - lo] == keys[a - lo]) b++;
+
+        auto i = suffixes[a];
+        Node* child;
+        if (b - a == 1) {
+            child = new Node(i + d, n, n - i, a, b);
+            child->expanded = true;
+        }
+        else {
+            // the first string depth at which the group disagrees
+            auto child_depth = d + 1;
+            for (bool agree = true; agree; ) {
+                for (auto k = a; k < b && agree; k++) {
+                    agree = suffixes[k] + child_depth < n && txt[suffixes[k] + child_depth] == txt[i + child_depth];
+                }
+                if (agree) child_depth++;
+            }
+            child = new Node(i + d, i + child_depth, child_depth, a, b);
+        }
+        node->children[txt[i + d]] = child;
+        size++;
+        a = b;
+    }
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+
+
+/*
+see SuffixTree::find_internal_node
+*/
+std::pair<LazySuffixTree::Node*, uint32_t> LazySuffixTree::find_internal_node(std::string_view s) {
+    auto node = root.get(); // start from the root
+    uint32_t i = 0; // at each iteration, search for s[i:]
+    while (true) {
+        // all characters in s have been matched: s exists and its is an internal node
+        if (i >= s.size()) return { node, i - (uint32_t)s.size() };
+
+        expand(node);
+        auto pair = node->children.find(s[i]);
+        // s doesn't exist
+        if (pair == node->children.end()) return {nullptr, 0};
+
+        auto child = pair->second;
+        // s corresponds to an leaf node
+        if (child->is_leaf()) return {nullptr, 1};
+
+        // the number of characters need to be compared for this edge
+        auto len = std::min(child->end - child->start, (uint32_t)s.size() - i);
+        // mismatch: s doesn't exist
+        if (s.substr(i, len) != txt.substr(child->start, len)) return {nullptr, 0};
+        node = child;
+        i += node->end - node->start;
+    }
+    assert(false);
+}
+
+
+// compute the net frequency of a single substring s:
+// a leaf child Sy of S (occurring at position i) counts iff xS is unique (x = txt[i-1]),
+// which is answered by looking up xS in the tree itself instead of following a weiner link
+uint32_t LazySuffixTree::single_nf(std::string_view s) {
+    auto [S, left_len_S] = find_internal_node(s);
+    // s doesn't exist, or is unique, or is non-branching
+    if (S == nullptr || left_len_S != 0) return 0;
+
+    expand(S);
+    uint32_t nf = 0;
+    for (const auto& [_, child] : S->children) {
+        if (!child->is_leaf()) continue;
+        auto i = suffixes[child->lo];
+        if (i == 0) {
+            nf++;
+            continue;
+        }
+        auto [xS, left_len_xS] = find_internal_node(txt.substr(i - 1, s.size() + 1));
+        if (xS == nullptr && left_len_xS == 1) nf++;
+    }
+    return nf;
+}
+
+
+
+
+// ==========================================================================================
+//                                  other functions
+// ==========================================================================================
+
+
+// node destructor, the descendants are freed from an explicit stack rather than recursively
+// (the tree of a repetitive text is as deep as its longest repeat, which would overflow the call stack)
+LazySuffixTree::Node::~Node() {
+    std::vector<Node*> stack;
+    for (auto& [_, child] : children) stack.push_back(child);
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        for (auto& [_, child] : node->children) stack.push_back(child);
+        node->children.clear();
+        delete node;
+    }
+}
+
+// lazy suffix tree constructor
+LazySuffixTree::LazySuffixTree(std::string_view _txt) :
+    txt(_txt),
+    suffixes(check_length32(_txt.size(), "LazySuffixTree")),
+    root(std::make_unique<Node>(0, 0, 0, 0, (uint32_t)_txt.size())),
+    size(1) {
+    std::iota(suffixes.begin(), suffixes.end(), 0);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <unordered_map>
+#include <string_view>
+#include <memory> // std::unique_ptr
+#include <vector>
+#include <utility> // std::pair
+#include <cstdint>
+
+
+// a suffix tree built top-down on demand (write-only top-down, "lazy" suffix tree):
+// a node's children are only computed the first time a query needs them,
+// so queries for a few patterns never pay for building the whole tree
+class LazySuffixTree {
+public:
+    // each node includes the node and the edge leading to the node,
+    // the string label for the edge is txt[start, end)
+    // (a leaf is a node with a single suffix below it, its edge runs to the end of the text)
+    class Node {
+    public:
+        uint32_t start;
+        uint32_t end;
+        // string depth of the node (the length of the string from the root to the node)
+        uint32_t depth;
+        // the suffixes below the node are suffixes[lo...hi-1]
+        uint32_t lo, hi;
+        // whether `children` has been computed
+        bool expanded;
+        std::unordered_map<char, Node*> children;
+
+        bool is_leaf() const { return hi - lo == 1; }
+
+        Node(uint32_t i, uint32_t j, uint32_t d, uint32_t l, uint32_t h):
+            start(i), end(j), depth(d), lo(l), hi(h), expanded(false) {}
+        ~Node();
+    };
+
+private:
+    // the input text
+    std::string_view txt;
+    // the suffixes, each node's suffixes form a contiguous range that is sorted when it is expanded
+    std::vector<uint32_t> suffixes;
+    // scratch space for sorting a range of suffixes by one character
+    std::vector<uint32_t> buffer;
+    std::vector<unsigned char> keys;
+
+    // compute the children of an internal node
+    void expand(Node* node);
+
+public:
+    std::unique_ptr<Node> root;
+
+    // constructor, nothing but the root is built (the text must end with a unique terminator)
+    // (32-bit positions, see check_length32 in index.hpp)
+    LazySuffixTree(std::string_view _txt);
+
+    // as SuffixTree::find_internal_node, expanding the nodes along the path
+    std::pair<Node*, uint32_t> find_internal_node(std::string_view s);
+
+    uint32_t single_nf(std::string_view s);
+
+    // the number of nodes built so far
+    uint32_t size;
+};
@@ -1,5 +1,33 @@
 #include "suffix_tree.hpp"
+#include "fm_index.hpp"
+#include "succinct_suffix_tree.hpp"
+#include "suffix_array.hpp"
+#include "lazy_suffix_tree.hpp"
+#include "r_index.hpp"
+#include "enhanced_suffix_array.hpp"
+#include "external_nf.hpp"
 #include <assert.h>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <fstream>
+
+
+// the lines printed by all_nf (of any index), sorted
+template <typename Index>
+static std::vector<std::string> all_nf_of(Index& index) {
+    std::ostringstream out;
+    auto old = std::cout.rdbuf(out.rdbuf());
+    index.all_nf();
+    std::cout.rdbuf(old);
+    std::vector<std::string> lines;
+    std::istringstream in(out.str());
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
 
 
 int main() {
@@ -11,5 +39,261 @@ int main() {
     
     st.all_nf();
     
+    // all_nf reports each string by its own path label, and a second call starts afresh
+    auto reported = all_nf_of(st);
+    assert(all_nf_of(st) == reported);
+    for (const auto& line : reported) {
+        auto tab = line.find('\t');
+        assert(st.single_nf(line.substr(0, tab)) == std::stoul(line.substr(tab + 1)));
+    }
+    
+    // an edited tree answers as a tree built on the edited text
+    SuffixTree edited{txt, SuffixTree::Options::for_edits()};
+    edited.apply_edits({{SuffixTree::Edit::Type::insert, 1, 'b'},
+                        {SuffixTree::Edit::Type::substitute, 8, 'c'},
+                        {SuffixTree::Edit::Type::erase, 12, '\0'}});
+    edited.insert(17, 'y');
+    const std::string edited_txt{edited.text()};
+    SuffixTree rebuilt{edited_txt};
+    for (size_t i = 0; i < edited_txt.size(); i++) {
+        for (size_t len = 1; i + len <= edited_txt.size(); len++) {
+            auto s = edited_txt.substr(i, len);
+            assert(edited.single_nf(s) == rebuilt.single_nf(s));
+        }
+    }
+    assert(all_nf_of(edited) == all_nf_of(rebuilt));
+    
+    // and can be rebuilt on its own (edited) text
+    edited.reset(edited.text());
+    assert(all_nf_of(edited) == all_nf_of(rebuilt));
+
+    // edits within a small edit window are repaired, the others rebuild the tree, and both answer alike
+    auto options = SuffixTree::Options::for_edits();
+    options.edit_window = 16;
+    std::string window_txt = "#";
+    for (size_t i = 0; i < 100; i++) window_txt += "abc"[i * i % 7 % 3];
+    window_txt += '$';
+    SuffixTree windowed{window_txt, options};
+    for (index_t e = 0; e < 40; e++) {
+        auto pos = (index_t)(1 + e * e * 13 % (windowed.text().size() - 2));
+        auto type = (SuffixTree::Edit::Type)(e % 3);
+        windowed.apply_edits({{type, pos, "abc"[e % 3]}});
+        const std::string windowed_txt{windowed.text()};
+        SuffixTree fresh{windowed_txt};
+        assert(all_nf_of(windowed) == all_nf_of(fresh));
+    }
+    
+    // NUL bytes in the text are counted apart from the FM-index's terminator placeholder, in every block
+    std::string nul_txt;
+    for (size_t i = 0; i < 300; i++) nul_txt += "ab\0c"[i * i % 7 % 4];
+    nul_txt += '$';
+    SuffixTree nul_st{nul_txt};
+    FMIndex nul_fm{nul_txt};
+    for (size_t i = 0; i < nul_txt.size(); i += 3) {
+        for (size_t len = 1; len <= 4 && i + len <= nul_txt.size(); len++) {
+            auto s = nul_txt.substr(i, len);
+            assert(nul_fm.single_nf(s) == nul_st.single_nf(s));
+        }
+    }
+
+    // a truncated tree lacks the deep nodes the succinct tree relies on, so it is refused
+    SuffixTree truncated{txt, SuffixTree::Truncated{2}};
+    bool refused = false;
+    try {
+        SuccinctSuffixTree copy{truncated};
+    }
+    catch (const std::logic_error&) {
+        refused = true;
+    }
+    assert(refused);
+
+    // the top-down constructions check their preconditions
+    refused = false;
+    try {
+        SuffixTree parallel{"abab", SuffixTree::Parallel{1, 1}};
+    }
+    catch (const std::invalid_argument&) {
+        refused = true;
+    }
+    assert(refused);
+
+    // a parallel construction answers as Ukkonen's, for any number of threads and prefix length
+    // (with prefixes as long as the text, and groups of a single suffix)
+    std::vector<std::string> parallel_txts{"$", "a$", "abcdef$", "aaaaaaaaaaaa$", txt, window_txt};
+    uint64_t state = 1;
+    for (unsigned sigma = 1; sigma <= 4; sigma++) {
+        std::string random_txt;
+        for (size_t i = 0; i < 60; i++) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            random_txt += (char)('a' + (state >> 33) % sigma);
+        }
+        parallel_txts.push_back(random_txt + '$');
+    }
+    for (const auto& parallel_txt : parallel_txts) {
+        SuffixTree ukkonen{parallel_txt};
+        auto expected = all_nf_of(ukkonen);
+        auto n = (uint32_t)parallel_txt.size();
+        for (unsigned threads : {1u, 2u, 3u}) {
+            for (uint32_t prefix_len : {1u, 2u, 3u, n, n + 5}) {
+                SuffixTree parallel{parallel_txt, SuffixTree::Parallel{threads, prefix_len}};
+                assert(all_nf_of(parallel) == expected);
+                for (size_t i = 0; i < parallel_txt.size(); i++) {
+                    for (size_t len = 1; len <= 6 && i + len <= parallel_txt.size(); len++) {
+                        auto s = parallel_txt.substr(i, len);
+                        assert(parallel.single_nf(s) == ukkonen.single_nf(s));
+                    }
+                }
+            }
+        }
+    }
+
+    // a truncated tree answers as the full one up to its maximum length, and refuses longer strings
+    for (const auto& truncated_txt : parallel_txts) {
+        SuffixTree full{truncated_txt};
+        for (index_t k : {1u, 2u, 4u}) {
+            SuffixTree shallow{truncated_txt, SuffixTree::Truncated{k, 2}};
+            assert(!shallow.complete());
+            for (size_t i = 0; i < truncated_txt.size(); i++) {
+                for (size_t len = 1; len <= k + 1 && i + len <= truncated_txt.size(); len++) {
+                    auto s = truncated_txt.substr(i, len);
+                    if (len <= k) {
+                        assert(shallow.single_nf(s) == full.single_nf(s));
+                        continue;
+                    }
+                    refused = false;
+                    try {
+                        shallow.single_nf(s);
+                    }
+                    catch (const std::out_of_range&) {
+                        refused = true;
+                    }
+                    assert(refused);
+                }
+            }
+        }
+    }
+
+    // a sparse tree over every position is the full tree, and over some of them counts as documented at Sparse:
+    // s has an occurrence at position p counted iff s is branching among the positions, s followed by its next character
+    // starts at no other position, and neither does the string from the previous position up to the end of s
+    parallel_txts.push_back("the cat sat on the mat, the cat ran at the rat$");
+    for (const auto& sparse_txt : parallel_txts) {
+        SuffixTree full{sparse_txt};
+        std::vector<index_t> every(sparse_txt.size());
+        for (index_t i = 0; i < every.size(); i++) every[i] = i;
+        SuffixTree all_positions{sparse_txt, SuffixTree::Sparse{every, 2}};
+        assert(!all_positions.complete());
+        assert(all_nf_of(all_positions) == all_nf_of(full));
+
+        for (index_t step : {2u, 3u, 0u}) {
+            // (step 0: the starts of the words)
+            std::vector<index_t> positions;
+            for (index_t i = 0; i < sparse_txt.size(); i++) {
+                if (step ? i % step == 0 : i == 0 || sparse_txt[i - 1] == ' ') positions.push_back(i);
+            }
+            SuffixTree sparse{sparse_txt, SuffixTree::Sparse{positions}};
+            assert(!sparse.complete());
+            auto starting = [&](std::string_view s) {
+                return std::count_if(positions.begin(), positions.end(), [&](index_t p) {
+                    return std::string_view{sparse_txt}.substr(p, s.size()) == s;
+                });
+            };
+            auto expected_nf = [&](std::string_view s) {
+                index_t nf = 0;
+                std::string right;
+                for (size_t r = 0; r < positions.size(); r++) {
+                    auto p = positions[r];
+                    if (std::string_view{sparse_txt}.substr(p, s.size()) != s || p + s.size() >= sparse_txt.size()) continue;
+                    auto y = sparse_txt[p + s.size()];
+                    if (right.find(y) == std::string::npos) right += y;
+                    auto from = r == 0 ? p : positions[r - 1];
+                    if (starting(std::string_view{sparse_txt}.substr(p, s.size() + 1)) == 1 &&
+                        (r == 0 || starting(std::string_view{sparse_txt}.substr(from, p + s.size() - from)) == 1)) {
+                        nf++;
+                    }
+                }
+                return right.size() >= 2 ? nf : 0;
+            };
+            std::vector<std::string> expected;
+            for (auto p : positions) {
+                for (size_t len = 1; p + len <= sparse_txt.size(); len++) {
+                    auto s = sparse_txt.substr(p, len);
+                    assert(sparse.single_nf(s) == expected_nf(s));
+                    if (expected_nf(s) > 0) expected.push_back(s + '\t' + std::to_string(expected_nf(s)));
+                }
+            }
+            std::sort(expected.begin(), expected.end());
+            expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+            assert(all_nf_of(sparse) == expected);
+        }
+    }
+
+    // the other indexes answer as the suffix tree (also on near-copies of a document, where the BWT has few runs)
+    std::string copies;
+    for (size_t c = 0; c < 20; c++) {
+        auto copy = txt.substr(1, txt.size() - 2);
+        copy[c % copy.size()] = 'z';
+        copies += copy;
+    }
+    parallel_txts.push_back(copies + '$');
+    for (const auto& other_txt : parallel_txts) {
+        SuffixTree reference{other_txt};
+        auto expected = all_nf_of(reference);
+        SuffixArray sa{other_txt, 2};
+        assert(all_nf_of(sa) == expected);
+        LazySuffixTree lazy{other_txt};
+        for (size_t i = 0; i < other_txt.size(); i++) {
+            for (size_t len = 1; len <= 6 && i + len <= other_txt.size(); len++) {
+                auto s = other_txt.substr(i, len);
+                assert(lazy.single_nf(s) == reference.single_nf(s));
+            }
+        }
+        // (a string missing from the text, and every line of all_nf, on nodes expanded by the queries above)
+        assert(lazy.single_nf("zz") == 0);
+        for (const auto& line : expected) {
+            auto s = line.substr(0, line.find('\t'));
+            assert(lazy.single_nf(s) == std::stoul(line.substr(line.find('\t') + 1)));
+        }
+        RIndex r_index{other_txt, 2};
+        assert(all_nf_of(r_index) == expected);
+        for (size_t i = 0; i < other_txt.size(); i++) {
+            for (size_t len = 1; len <= 6 && i + len <= other_txt.size(); len++) {
+                auto s = other_txt.substr(i, len);
+                assert(r_index.single_nf(s) == reference.single_nf(s));
+            }
+        }
+        // (and once saved and loaded back)
+        EnhancedSuffixArray esa{other_txt, 2};
+        auto esa_path = (std::filesystem::temp_directory_path() / "nf_main_esa").string();
+        esa.save(esa_path);
+        auto loaded = EnhancedSuffixArray::load(esa_path);
+        std::filesystem::remove(esa_path);
+        assert(loaded.text() == esa.text());
+        for (size_t i = 0; i < other_txt.size(); i++) {
+            for (size_t len = 1; len <= 6 && i + len <= other_txt.size(); len++) {
+                auto s = other_txt.substr(i, len);
+                assert(esa.single_nf(s) == reference.single_nf(s));
+                assert(loaded.single_nf(s) == reference.single_nf(s));
+            }
+        }
+    }
+
+    // the external construction, with the smallest memory budget, prints what the tree does
+    // (on texts long enough to be sorted in several runs, one periodic and one of a single repeated character)
+    std::string periodic;
+    while (periodic.size() < 30000) periodic += window_txt.substr(1, 37);
+    parallel_txts.push_back(periodic + '$');
+    parallel_txts.push_back(std::string(20000, 'a') + '$');
+    auto work_dir = std::filesystem::temp_directory_path() / "nf_main_external";
+    std::filesystem::create_directories(work_dir);
+    auto text_path = (work_dir / "text").string();
+    for (const auto& external_txt : parallel_txts) {
+        std::ofstream(text_path, std::ios::binary) << external_txt;
+        SuffixTree reference{external_txt};
+        ExternalNF external{text_path, work_dir.string(), ExternalNF::min_budget};
+        assert(all_nf_of(external) == all_nf_of(reference));
+    }
+    std::filesystem::remove_all(work_dir);
+
     return 0;
 }
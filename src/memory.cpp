@@ -0,0 +1,157 @@
+#include "./memory.hpp"
+
+#include <cstring> // std::memset
+#include <utility> // std::pair
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
+#endif
+
+
+
+// ==========================================================================================
+//                                  mapped memory
+// ==========================================================================================
+
+/*
+ - normal: operator new, cache line aligned;
+ - transparent: an anonymous mapping, rounded up to whole huge pages and aligned to 2 MiB
+   (by mapping 2 MiB more and trimming both ends), so that the kernel can back it by huge pages once madvised;
+ - huge: MAP_HUGETLB, falling back to transparent when no huge page is reserved;
+   (blocks smaller than a huge page are plain anonymous mappings with either policy,
+    a huge page faulted in whole for a small pool would mostly stay empty)
+ - interleave: mbind(MPOL_INTERLEAVE) over the nodes the process may use, before the pages are touched
+*/
+
+static constexpr size_t huge_page = (size_t)1 << 21;
+
+static bool mapped(const MemoryPolicy& policy) {
+#ifdef __linux__
+    return policy.pages != MemoryPolicy::Pages::normal || policy.interleave;
+#else
+    (void)policy;
+    return false;
+#endif
+}
+
+static constexpr size_t small_page = (size_t)1 << 12;
+
+static size_t round_up(size_t bytes) {
+    auto unit = bytes < huge_page ? small_page : huge_page;
+    return (bytes + unit - 1) / unit * unit;
+}
+
+#ifdef __linux__
+static void interleave(void* p, size_t bytes) {
+    // the nodes the process may allocate from, then one page after the other over them (best effort)
+    unsigned long mask[16] = {};
+    auto max_node = sizeof(mask) * 8;
+    if (syscall(SYS_get_mempolicy, nullptr, mask, max_node, nullptr, MPOL_F_MEMS_ALLOWED) != 0) return;
+    syscall(SYS_mbind, p, bytes, MPOL_INTERLEAVE, mask, max_node, 0);
+}
+#endif
+
+void* map_memory(size_t bytes, const MemoryPolicy& policy) {
+    if (!mapped(policy)) return ::operator new(bytes, std::align_val_t(64));
+#ifdef __linux__
+    bytes = round_up(bytes);
+    auto huge = bytes >= huge_page && policy.pages != MemoryPolicy::Pages::normal;
+    void* p = MAP_FAILED;
+    if (huge && policy.pages == MemoryPolicy::Pages::huge) {
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (p == MAP_FAILED) {
+        auto raw = mmap(nullptr, bytes + huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        auto begin = reinterpret_cast<uintptr_t>(raw);
+        auto aligned = (begin + huge_page - 1) / huge_page * huge_page;
+        if (aligned > begin) munmap(raw, aligned - begin);
+        munmap(reinterpret_cast<void*>(aligned + bytes), begin + huge_page - aligned);
+        p = reinterpret_cast<void*>(aligned);
+        if (huge) madvise(p, bytes, MADV_HUGEPAGE);
+    }
+    if (policy.interleave) interleave(p, bytes);
+    return p;
+#else
+    return nullptr;
+#endif
+}
+
+void unmap_memory(void* p, size_t bytes, const MemoryPolicy& policy) {
+    if (!mapped(policy)) {
+        ::operator delete(p, std::align_val_t(64));
+        return;
+    }
+#ifdef __linux__
+    munmap(p, round_up(bytes));
+#endif
+}
+
+
+
+
+// ==========================================================================================
+//                                      TLB counters
+// ==========================================================================================
+
+TlbCounters::TlbCounters() {
+    for (auto& fd : fds) fd = -1;
+#ifdef __linux__
+    auto cache_miss = [](uint64_t op) {
+        return PERF_COUNT_HW_CACHE_DTLB | op << 8 | (uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    };
+    std::pair<uint32_t, uint64_t> events[3] = {
+        {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_OP_READ)},
+        {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_OP_WRITE)},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+    };
+    for (int e = 0; e < 3; e++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[e].first;
+        attr.config = events[e].second;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+}
+
+TlbCounters::~TlbCounters() {
+#ifdef __linux__
+    for (auto fd : fds) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+void TlbCounters::start() {
+#ifdef __linux__
+    for (auto fd : fds) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+TlbCounters::Counts TlbCounters::stop() {
+    int64_t counts[3] = {-1, -1, -1};
+#ifdef __linux__
+    for (int e = 0; e < 3; e++) {
+        if (fds[e] < 0) continue;
+        ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(fds[e], &count, sizeof(count)) == sizeof(count)) counts[e] = (int64_t)count;
+    }
+#endif
+    return {counts[0], counts[1], counts[2]};
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <vector>
+#include <algorithm> // std::min
+#include <utility> // std::forward, std::swap
+#include <new>
+#include <assert.h>
+#include <cstdint>
+#include <cstddef>
+
+
+// how large blocks of memory are backed (Linux only, elsewhere every policy falls back to the default heap)
+struct MemoryPolicy {
+    enum class Pages {
+        normal,      // the default heap
+        transparent, // anonymous mappings aligned to 2 MiB and madvise(MADV_HUGEPAGE)
+        huge         // MAP_HUGETLB (explicit huge pages, which must be reserved), else as transparent
+    };
+    Pages pages = Pages::normal;
+    // interleave the pages over all the allowed NUMA nodes, otherwise a page is placed on the node
+    // of the thread that touches it first (so the subtrees built by one thread stay local to it)
+    bool interleave = false;
+};
+
+// a block of at least `bytes` bytes backed as the policy asks (throws std::bad_alloc),
+// to be released by unmap_memory with the same size and policy
+void* map_memory(size_t bytes, const MemoryPolicy& policy);
+void unmap_memory(void* p, size_t bytes, const MemoryPolicy& policy);
+
+
+// fixed-size objects carved out of chunks obtained from map_memory, the chunks growing geometrically
+// (so that small trees stay small and the bulk of a large one lies in chunks of many huge pages);
+// destroyed objects are recycled, and the chunks are only released with the pool
+template <typename T>
+class Pool {
+private:
+    struct Chunk {
+        T* objects;
+        size_t capacity;
+    };
+    MemoryPolicy policy;
+    std::vector<Chunk> chunks;
+    // the number of objects handed out from the last chunk
+    size_t used;
+    std::vector<T*> free_list;
+
+    static constexpr size_t first_chunk = (size_t)1 << 16, last_chunk = (size_t)1 << 25; // in bytes
+
+    void grow() {
+        auto bytes = chunks.empty() ? first_chunk : std::min(2 * chunks.back().capacity * sizeof(T), last_chunk);
+        auto capacity = bytes / sizeof(T);
+        chunks.push_back({static_cast<T*>(map_memory(capacity * sizeof(T), policy)), capacity});
+        used = 0;
+    }
+
+public:
+    Pool(MemoryPolicy _policy = {}) : policy(_policy), used(0) {}
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+    Pool(Pool&& other) noexcept : Pool(other.policy) { swap(other); }
+    Pool& operator=(Pool&& other) noexcept { swap(other); return *this; }
+    // (the objects must have been destroyed already)
+    ~Pool() { release(); }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        T* p;
+        if (!free_list.empty()) {
+            p = free_list.back();
+            free_list.pop_back();
+        }
+        else {
+            if (chunks.empty() || used == chunks.back().capacity) grow();
+            p = chunks.back().objects + used++;
+        }
+        return new (p) T(std::forward<Args>(args)...);
+    }
+    void destroy(T* p) {
+        p->~T();
+        free_list.push_back(p);
+    }
+
+    // room for n more objects in one chunk, so that the next n created (with nothing in the free list) are contiguous
+    void reserve(size_t n) {
+        if (n == 0 || (!chunks.empty() && chunks.back().capacity - used >= n)) return;
+        chunks.push_back({static_cast<T*>(map_memory(n * sizeof(T), policy)), n});
+        used = 0;
+    }
+
+    // take over the chunks of another pool with the same policy (e.g., one filled by another thread)
+    void adopt(Pool&& other) {
+        assert(other.policy.pages == policy.pages && other.policy.interleave == policy.interleave);
+        if (other.chunks.empty()) return;
+        // the last chunk of `other` becomes the one handed out from
+        if (!chunks.empty()) {
+            auto& last = chunks.back();
+            for (auto p = last.objects + used; p != last.objects + last.capacity; p++) free_list.push_back(p);
+        }
+        chunks.insert(chunks.end(), other.chunks.begin(), other.chunks.end());
+        free_list.insert(free_list.end(), other.free_list.begin(), other.free_list.end());
+        used = other.used;
+        other.chunks.clear();
+        other.free_list.clear();
+        other.used = 0;
+    }
+
+    void release() {
+        for (auto& chunk : chunks) unmap_memory(chunk.objects, chunk.capacity * sizeof(T), policy);
+        chunks.clear();
+        free_list.clear();
+        used = 0;
+    }
+
+    void swap(Pool& other) noexcept {
+        std::swap(policy, other.policy);
+        chunks.swap(other.chunks);
+        std::swap(used, other.used);
+        free_list.swap(other.free_list);
+    }
+
+    size_t size_in_bytes() const {
+        size_t bytes = free_list.capacity() * sizeof(T*);
+        for (auto& chunk : chunks) bytes += chunk.capacity * sizeof(T);
+        return bytes;
+    }
+};
+
+
+// hardware counters of the calling thread (and of the threads it starts while counting) via perf_event_open:
+// dTLB load and store misses, and page faults (a software event, available even without a PMU)
+class TlbCounters {
+public:
+    struct Counts {
+        // -1 when the event is not available (no PMU, or perf_event_paranoid forbids it)
+        int64_t dtlb_load_misses, dtlb_store_misses, page_faults;
+    };
+
+private:
+    int fds[3];
+
+public:
+    TlbCounters();
+    TlbCounters(const TlbCounters&) = delete;
+    TlbCounters& operator=(const TlbCounters&) = delete;
+    ~TlbCounters();
+
+    void start();
+    Counts stop();
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm> // std::sort, std::merge
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+// the number of threads to use when the caller asks for 0 (i.e., "all cores")
+inline unsigned resolve_threads(unsigned threads) {
+    if (threads != 0) return threads;
+    auto cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+}
+
+// call f(i) for every i in [0, n) using `threads` threads (the calling thread included),
+// indices are handed out one at a time so that tasks of uneven sizes balance themselves
+template <typename F>
+void parallel_for(size_t n, unsigned threads, F f) {
+    std::atomic<size_t> next = 0;
+    auto work = [&]() {
+        for (size_t i = next++; i < n; i = next++) f(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < resolve_threads(threads) && t < n; t++) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (auto& thread : pool) thread.join();
+}
+
+// call f(i) for every i in [0, n), handing out blocks of consecutive indices
+// (for loops whose iterations are cheap and uniform)
+template <typename F>
+void parallel_for_blocked(size_t n, unsigned threads, F f) {
+    const size_t block = (size_t)1 << 16;
+    parallel_for((n + block - 1) / block, threads, [&](size_t b) {
+        for (auto i = b * block; i < std::min(n, (b + 1) * block); i++) f(i);
+    });
+}
+
+// sort `v` with `threads` threads: each thread sorts one chunk, then the chunks are merged pairwise
+template <typename T, typename Compare>
+void parallel_sort(std::vector<T>& v, unsigned threads, Compare comp) {
+    threads = resolve_threads(threads);
+    // chunks of at least 2^16 elements, small inputs are not worth the threads
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, v.size() >> 16));
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t c = 0; c <= chunks; c++) bounds[c] = v.size() * c / chunks;
+
+    parallel_for(chunks, threads, [&](size_t c) {
+        std::sort(v.begin() + (long)bounds[c], v.begin() + (long)bounds[c + 1], comp);
+    });
+
+    std::vector<T> buffer(chunks > 1 ? v.size() : 0);
+    for (size_t width = 1; width < chunks; width *= 2) {
+        parallel_for((chunks + 2 * width - 1) / (2 * width), threads, [&](size_t pair) {
+            auto lo = bounds[pair * 2 * width];
+            auto mid = bounds[std::min(chunks, pair * 2 * width + width)];
+            auto hi = bounds[std::min(chunks, pair * 2 * width + 2 * width)];
+            std::merge(v.begin() + (long)lo, v.begin() + (long)mid, v.begin() + (long)mid, v.begin() + (long)hi,
+                       buffer.begin() + (long)lo, comp);
+        });
+        v.swap(buffer);
+    }
+}
+
+// replace v[i] by v[0] + ... + v[i] (inclusive prefix sums) with `threads` threads
+template <typename T>
+void parallel_prefix_sum(std::vector<T>& v, unsigned threads) {
+    threads = resolve_threads(threads);
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, v.size() >> 16));
+    std::vector<T> sums(chunks, 0);
+    auto lo = [&](size_t c) { return v.size() * c / chunks; };
+
+    parallel_for(chunks, threads, [&](size_t c) {
+        for (auto i = lo(c) + 1; i < lo(c + 1); i++) v[i] += v[i - 1];
+        if (lo(c) < lo(c + 1)) sums[c] = v[lo(c + 1) - 1];
+    });
+    for (size_t c = 1; c < chunks; c++) sums[c] += sums[c - 1];
+    parallel_for(chunks, threads, [&](size_t c) {
+        if (c == 0) return;
+        for (auto i = lo(c); i < lo(c + 1); i++) v[i] += sums[c - 1];
+    });
+}
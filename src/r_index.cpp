@@ -0,0 +1,221 @@
+#include "./r_index.hpp"
+#include "./suffix_array.hpp"
+#include "./index.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <algorithm> // std::upper_bound, std::min, std::sort
+
+
+
+// ==========================================================================================
+//                                  run-length BWT
+// ==========================================================================================
+
+RIndex::RLBWT::RLBWT(std::string_view bwt, uint32_t primary, char last) :
+    runs(256),
+    C(257, 0),
+    rows((uint32_t)bwt.size() + 1),
+    terminator_row(primary + 1) {
+    // row 0 is the empty suffix, preceded by the last character of the text
+    auto row = [&](uint32_t k) -> uint16_t {
+        if (k == 0) return (unsigned char)last;
+        if (k == terminator_row) return terminator;
+        return (unsigned char)bwt[k - 1];
+    };
+
+    std::vector<uint32_t> count(256, 0);
+    for (uint32_t k = 0; k < rows; k++) {
+        auto c = row(k);
+        if (k == 0 || c != heads.back()) {
+            starts.push_back(k);
+            heads.push_back(c);
+            if (c != terminator) {
+                runs[c].starts.push_back(k);
+                runs[c].before.push_back(count[c]);
+            }
+        }
+        if (c != terminator) count[c]++;
+    }
+    for (size_t c = 0; c < 256; c++) {
+        if (!runs[c].starts.empty()) runs[c].before.push_back(count[c]);
+    }
+
+    C[0] = 1;
+    for (size_t c = 0; c < 256; c++) C[c + 1] = C[c] + count[c];
+}
+
+size_t RIndex::RLBWT::run(uint32_t k) const {
+    return (size_t)(std::upper_bound(starts.begin(), starts.end(), k) - starts.begin()) - 1;
+}
+
+uint32_t RIndex::RLBWT::rank(unsigned char c, uint32_t k) const {
+    const auto& R = runs[c];
+    auto j = (size_t)(std::upper_bound(R.starts.begin(), R.starts.end(), k) - R.starts.begin());
+    if (j == 0) return 0;
+    j--;
+    return R.before[j] + std::min(k - R.starts[j], R.before[j + 1] - R.before[j]);
+}
+
+uint32_t RIndex::RLBWT::select(unsigned char c, uint32_t j) const {
+    const auto& R = runs[c];
+    auto r = (size_t)(std::upper_bound(R.before.begin(), R.before.end() - 1, j) - R.before.begin()) - 1;
+    return R.starts[r] + (j - R.before[r]);
+}
+
+unsigned char RIndex::RLBWT::first(uint32_t k) const {
+    return (unsigned char)(std::upper_bound(C.begin(), C.end(), k) - C.begin() - 1);
+}
+
+uint32_t RIndex::RLBWT::psi(uint32_t k) const {
+    auto c = first(k);
+    return select(c, k - C[c]);
+}
+
+size_t RIndex::RLBWT::size_in_bytes() const {
+    size_t size = starts.size() * sizeof(uint32_t) + heads.size() * sizeof(uint16_t) + C.size() * sizeof(uint32_t);
+    for (const auto& R : runs) size += (R.starts.size() + R.before.size()) * sizeof(uint32_t);
+    return size;
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+/*
+
+the forward BWT answers left extensions (backward search), the reverse BWT right extensions:
+the rows of S in the forward BWT are sorted by the character following S,
+which is the character preceding rev(S) in the reverse BWT, so
+ - the rows of Sy start after the rows of S followed by the end of the text or by a character c < y,
+   i.e., after the reverse BWT rows of S holding the terminator or a c < y, and vice versa for xS;
+ - S is branching iff its reverse BWT rows hold two distinct characters, i.e., are not a single run;
+ - a leaf child Sy (a single row k) counts iff x = bwt[k] occurs once in the forward BWT rows of S
+   (or x is the terminator: the occurrence at position 0)
+
+*/
+
+bool RIndex::branching(const Interval& S) const {
+    return S.size > 1 && reverse.run(S.rl) != reverse.run(S.rl + S.size - 1);
+}
+
+// the net frequency of a branching substring
+uint32_t RIndex::nf(const Interval& S) const {
+    auto l = S.l, r = S.l + S.size;
+    auto counts = [&](uint32_t k) {
+        auto x = forward.access(k);
+        return x == RLBWT::terminator || forward.rank((unsigned char)x, r) - forward.rank((unsigned char)x, l) == 1;
+    };
+
+    uint32_t nf = 0;
+    auto k = l;
+    // S is a suffix of the text (there is no character y, so it is not counted)
+    if (reverse.terminator_row >= S.rl && reverse.terminator_row < S.rl + S.size) k++;
+    for (auto y : alphabet) {
+        auto size = reverse.rank(y, S.rl + S.size) - reverse.rank(y, S.rl);
+        if (size == 1) nf += counts(k);
+        k += size;
+    }
+    return nf;
+}
+
+// the first len characters of the suffix in row k
+std::string RIndex::extract(uint32_t k, uint32_t len) const {
+    std::string s(len, '\0');
+    for (uint32_t i = 0; i < len; i++) {
+        s[i] = (char)forward.first(k);
+        k = forward.psi(k);
+    }
+    return s;
+}
+
+
+// compute the net frequency of a single substring s:
+// backward search in both BWTs, then the right extension counts as above
+uint32_t RIndex::single_nf(std::string_view s) const {
+    uint32_t l = 0, r = forward.rows, rl = 0, rr = reverse.rows;
+    for (auto c = s.rbegin(); c != s.rend() && l < r; c++) {
+        auto x = (unsigned char)*c;
+        l = forward.C[x] + forward.rank(x, l);
+        r = forward.C[x] + forward.rank(x, r);
+    }
+    for (auto c = s.begin(); c != s.end() && rl < rr; c++) {
+        auto x = (unsigned char)*c;
+        rl = reverse.C[x] + reverse.rank(x, rl);
+        rr = reverse.C[x] + reverse.rank(x, rr);
+    }
+    Interval S{l, rl, r > l ? r - l : 0, (uint32_t)s.size()};
+    assert(S.size == (rr > rl ? rr - rl : 0));
+    // s doesn't exist, or is unique, or is non-branching
+    if (!branching(S)) return 0;
+    return nf(S);
+}
+
+
+/*
+compute the net frequencies for all the branching substrings:
+every suffix of a right-maximal string is right-maximal, so they are all reached from the empty string
+by left extensions (weiner links) that stay right-maximal;
+the traversal is depth-first, and the largest extension is pushed first so that the stack stays
+within sigma * log(n) intervals (each one popped before is at most half of its parent)
+*/
+void RIndex::all_nf() const {
+    std::vector<Interval> stack{{0, 0, forward.rows, 0}};
+    std::vector<Interval> children;
+    while (!stack.empty()) {
+        auto S = stack.back();
+        stack.pop_back();
+        if (S.depth > 0) {
+            auto nf_S = nf(S);
+            if (nf_S) std::cout << extract(S.l, S.depth) << '\t' << nf_S << std::endl;
+        }
+
+        // the reverse BWT rows of xS start after those of S preceded by the terminator or by a c < x
+        auto l = S.l, r = S.l + S.size;
+        auto rl = S.rl + (forward.terminator_row >= l && forward.terminator_row < r);
+        children.clear();
+        for (auto x : alphabet) {
+            auto lo = forward.rank(x, l), size = forward.rank(x, r) - lo;
+            Interval xS{forward.C[x] + lo, rl, size, S.depth + 1};
+            if (branching(xS)) children.push_back(xS);
+            rl += size;
+        }
+        std::sort(children.begin(), children.end(), [](const Interval& a, const Interval& b) {
+            return a.size > b.size;
+        });
+        stack.insert(stack.end(), children.begin(), children.end());
+    }
+}
+
+
+
+
+// ==========================================================================================
+//                                  other functions
+// ==========================================================================================
+
+
+// r-index constructor, the suffix array of one direction is released before the other one is built
+RIndex::RIndex(std::string_view txt, unsigned threads) :
+    n((uint32_t)check_length32(txt.size(), "RIndex")) {
+    if (n == 0) return;
+    {
+        SuffixArray sa{txt, threads};
+        forward = RLBWT(sa.bwt, (uint32_t)sa.primary, txt.back());
+    }
+    std::string reversed(txt.rbegin(), txt.rend());
+    {
+        SuffixArray sa{reversed, threads};
+        reverse = RLBWT(sa.bwt, (uint32_t)sa.primary, reversed.back());
+    }
+    for (size_t c = 0; c < 256; c++) {
+        if (!forward.runs[c].starts.empty()) alphabet.push_back((unsigned char)c);
+    }
+}
+
+size_t RIndex::size_in_bytes() const {
+    return forward.size_in_bytes() + reverse.size_in_bytes() + alphabet.size();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// a bidirectional index over the run-length encoded BWTs of the text and of the reversed text,
+// its space is O(r) words where r is the number of BWT runs (tiny for repetitive collections),
+// the text itself is not kept
+class RIndex {
+private:
+    // a run-length encoded BWT, with n+1 rows (row 0 being the empty suffix)
+    // where the row of suffix 0 holds the virtual terminator
+    class RLBWT {
+    public:
+        static constexpr uint16_t terminator = 256;
+
+        // the first row and the character of every run
+        std::vector<uint32_t> starts;
+        std::vector<uint16_t> heads;
+        // runs[c].starts = the first row of every run of c,
+        // runs[c].before[j] = the number of c's in the runs before the j-th (with the total at the end)
+        struct Runs {
+            std::vector<uint32_t> starts, before;
+        };
+        std::vector<Runs> runs;
+        // C[c] = the number of rows whose suffix starts with a character smaller than c (the empty one included)
+        std::vector<uint32_t> C;
+        uint32_t rows, terminator_row;
+
+        RLBWT() : rows(0), terminator_row(0) {}
+        // `bwt` and `primary` as in SuffixArray, `last` = the last character of the text
+        RLBWT(std::string_view bwt, uint32_t primary, char last);
+
+        // the run containing row k
+        size_t run(uint32_t k) const;
+        uint16_t access(uint32_t k) const { return heads[run(k)]; }
+        // the number of c's in rows [0, k)
+        uint32_t rank(unsigned char c, uint32_t k) const;
+        // the row of the j-th c (counting from 0)
+        uint32_t select(unsigned char c, uint32_t j) const;
+        // the first character of the suffix in row k (k > 0)
+        unsigned char first(uint32_t k) const;
+        // the row of the suffix following the one in row k (k > 0)
+        uint32_t psi(uint32_t k) const;
+
+        size_t size_in_bytes() const;
+    };
+
+    // a substring: its rows [l, l + size) in the forward BWT and [rl, rl + size) in the reverse BWT
+    struct Interval {
+        uint32_t l, rl, size, depth;
+    };
+
+    uint32_t n;
+    RLBWT forward, reverse;
+    // the characters of the text, in increasing order
+    std::vector<unsigned char> alphabet;
+
+    // S is right-maximal iff the reverse BWT rows of S are not a single run
+    bool branching(const Interval& S) const;
+    uint32_t nf(const Interval& S) const;
+    std::string extract(uint32_t k, uint32_t len) const;
+
+public:
+    // constructor, via two (temporary) suffix arrays (32-bit positions, see check_length32 in index.hpp)
+    RIndex(std::string_view txt, unsigned threads = 0);
+
+    uint32_t single_nf(std::string_view s) const;
+
+    void all_nf() const;
+
+    // the number of runs of the forward BWT
+    size_t runs() const { return forward.heads.size(); }
+    size_t size_in_bytes() const;
+};
@@ -0,0 +1,448 @@
+#include "./succinct.hpp"
+
+#include <assert.h>
+#include <algorithm> // std::min
+#include <bit> // std::popcount, std::countr_zero
+#include <climits>
+#include <queue> // std::priority_queue
+#include <array>
+#include <iterator> // std::begin, std::end
+#include <functional> // std::greater
+
+
+
+// ==========================================================================================
+//                                      bit vector
+// ==========================================================================================
+
+BitVector::BitVector(size_t _n) :
+    words((_n + 63) / 64, 0),
+    n(_n) {}
+
+void BitVector::build() {
+    ranks.assign(words.size() / 8 + 2, 0);
+    for (size_t w = 0; w < words.size(); w++) {
+        ranks[w / 8 + 1] += (uint64_t)std::popcount(words[w]);
+    }
+    for (size_t b = 1; b < ranks.size(); b++) ranks[b] += ranks[b - 1];
+}
+
+size_t BitVector::rank1(size_t i) const {
+    auto w = i / 64;
+    size_t r = ranks[w / 8];
+    for (auto v = w / 8 * 8; v < w; v++) r += (size_t)std::popcount(words[v]);
+    if (i % 64) r += (size_t)std::popcount(words[w] & (((uint64_t)1 << (i % 64)) - 1));
+    return r;
+}
+
+size_t BitVector::select1(size_t j) const {
+    // the last block with fewer than j+1 ones before it, then word by word
+    size_t lo = 0, hi = ranks.size() - 1;
+    while (hi - lo > 1) {
+        auto mid = (lo + hi) / 2;
+        if (ranks[mid] <= j) lo = mid;
+        else hi = mid;
+    }
+    j -= ranks[lo];
+    auto w = lo * 8;
+    for (;; w++) {
+        auto ones = (size_t)std::popcount(words[w]);
+        if (j < ones) break;
+        j -= ones;
+    }
+    auto word = words[w];
+    for (; j > 0; j--) word &= word - 1;
+    return w * 64 + (size_t)std::countr_zero(word);
+}
+
+size_t BitVector::size_in_bytes() const {
+    return (words.size() + ranks.size()) * sizeof(uint64_t);
+}
+
+
+
+
+// ==========================================================================================
+//                                    packed integers
+// ==========================================================================================
+
+IntVector::IntVector(size_t _n, uint64_t max) :
+    n(_n),
+    width((unsigned)std::max<uint64_t>((uint64_t)std::bit_width(max), 1)) {
+    words.assign((n * width + 63) / 64 + 1, 0);
+}
+
+uint64_t IntVector::get(size_t i) const {
+    auto bit = i * width;
+    auto w = bit / 64, offset = bit % 64;
+    auto x = words[w] >> offset;
+    if (offset + width > 64) x |= words[w + 1] << (64 - offset);
+    return width == 64 ? x : x & (((uint64_t)1 << width) - 1);
+}
+
+void IntVector::set(size_t i, uint64_t x) {
+    assert(width == 64 || x >> width == 0);
+    auto bit = i * width;
+    auto w = bit / 64, offset = bit % 64;
+    auto mask = width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+    words[w] = (words[w] & ~(mask << offset)) | x << offset;
+    if (offset + width > 64) {
+        words[w + 1] = (words[w + 1] & ~(mask >> (64 - offset))) | x >> (64 - offset);
+    }
+}
+
+size_t IntVector::size_in_bytes() const {
+    return words.size() * sizeof(uint64_t);
+}
+
+
+
+
+// ==========================================================================================
+//                                     wavelet tree
+// ==========================================================================================
+
+/*
+the tree is the Huffman tree of the byte frequencies: each internal node holds one bit per occurrence of the bytes below it
+(in the order of the string), the bit of the code at that depth, so following a byte down the tree
+is a rank0 or a rank1 per node, and the bits of all the nodes add up to the total length of the encoded string
+(Grossi, Gupta and Vitter, "High-order entropy-compressed text indexes"; Mäkinen and Navarro, "Succinct suffix arrays
+ based on run-length encoding", for the Huffman shape)
+*/
+
+WaveletTree::WaveletTree(std::string_view s) :
+    only(-1),
+    n(s.size()) {
+    std::fill(std::begin(codes), std::end(codes), 0);
+    std::fill(std::begin(lengths), std::end(lengths), 0);
+    uint64_t freq[256] = {};
+    for (auto c : s) freq[(unsigned char)c]++;
+
+    // the Huffman tree: leaves 0...255 are the bytes, the merged nodes come after them
+    using Entry = std::pair<uint64_t, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (int c = 0; c < 256; c++) {
+        if (freq[c]) queue.push({freq[c], c});
+    }
+    if (queue.size() <= 1) {
+        if (!queue.empty()) only = (int16_t)queue.top().second;
+        return;
+    }
+    std::vector<std::array<int, 2>> merged;
+    while (queue.size() > 1) {
+        auto a = queue.top();
+        queue.pop();
+        auto b = queue.top();
+        queue.pop();
+        merged.push_back({a.second, b.second});
+        queue.push({a.first + b.first, 256 + (int)merged.size() - 1});
+    }
+
+    // number the internal nodes from the root down, and give every byte its code
+    nodes.resize(merged.size());
+    std::vector<uint64_t> sizes(merged.size(), 0);
+    // (node of the Huffman tree, its number, its depth, the code so far)
+    struct Visit {
+        int huffman;
+        int32_t node;
+        unsigned depth;
+        uint64_t code;
+    };
+    std::vector<Visit> stack{{queue.top().second, 0, 0, 0}};
+    int32_t numbered = 1;
+    while (!stack.empty()) {
+        auto [huffman, node, depth, code] = stack.back();
+        stack.pop_back();
+        for (int b = 0; b < 2; b++) {
+            auto below = merged[(size_t)huffman - 256][(size_t)b];
+            auto below_code = code | (uint64_t)b << depth;
+            if (below < 256) {
+                nodes[(size_t)node].child[b] = -1 - below;
+                codes[below] = below_code;
+                lengths[below] = (uint8_t)(depth + 1);
+            }
+            else {
+                nodes[(size_t)node].child[b] = numbered;
+                stack.push_back({below, numbered++, depth + 1, below_code});
+            }
+        }
+    }
+    assert(*std::max_element(std::begin(lengths), std::end(lengths)) <= 64);
+
+    // the size of every node, then its bits
+    for (int c = 0; c < 256; c++) {
+        int32_t node = 0;
+        for (unsigned d = 0; d < lengths[c]; d++) {
+            sizes[(size_t)node] += freq[c];
+            node = nodes[(size_t)node].child[codes[c] >> d & 1];
+        }
+    }
+    for (size_t v = 0; v < nodes.size(); v++) nodes[v].bits = BitVector(sizes[v]);
+    std::fill(sizes.begin(), sizes.end(), 0);
+    for (auto ch : s) {
+        auto c = (unsigned char)ch;
+        int32_t node = 0;
+        for (unsigned d = 0; d < lengths[c]; d++) {
+            auto b = codes[c] >> d & 1;
+            if (b) nodes[(size_t)node].bits.set(sizes[(size_t)node]);
+            sizes[(size_t)node]++;
+            node = nodes[(size_t)node].child[b];
+        }
+    }
+    for (auto& node : nodes) node.bits.build();
+}
+
+unsigned char WaveletTree::access(size_t k) const {
+    if (nodes.empty()) return (unsigned char)only;
+    int32_t node = 0;
+    while (node >= 0) {
+        const auto& v = nodes[(size_t)node];
+        auto b = v.bits.get(k);
+        k = b ? v.bits.rank1(k) : v.bits.rank0(k);
+        node = v.child[b];
+    }
+    return (unsigned char)(-1 - node);
+}
+
+size_t WaveletTree::rank(unsigned char c, size_t k) const {
+    if (nodes.empty()) return c == only ? k : 0;
+    if (lengths[c] == 0) return 0;
+    int32_t node = 0;
+    for (unsigned d = 0; d < lengths[c]; d++) {
+        const auto& v = nodes[(size_t)node];
+        auto b = codes[c] >> d & 1;
+        k = b ? v.bits.rank1(k) : v.bits.rank0(k);
+        node = v.child[b];
+    }
+    return k;
+}
+
+size_t WaveletTree::size_in_bytes() const {
+    size_t size = sizeof(codes) + sizeof(lengths);
+    for (const auto& node : nodes) size += node.bits.size_in_bytes() + sizeof(node.child);
+    return size;
+}
+
+
+
+
+// ==========================================================================================
+//                                  balanced parentheses
+// ==========================================================================================
+
+/*
+a simplified range min-max tree (Navarro and Sadakane, "Fully functional static and dynamic succinct trees"):
+a segment tree over blocks of 8 words stores the minimum excess reached inside each range of blocks,
+the excess before any word comes from rank, so a search scans the words of at most two blocks
+(a word at a time, with a table over its bytes) and walks the tree once;
+at one int32 per 512 bits the tree costs 1/8 of a bit per parenthesis
+*/
+
+static constexpr size_t block_words = 8;
+
+// the minimum excess reached within a byte (read from its lowest bit) and its total excess
+struct ByteExcess {
+    int8_t min[256];
+    int8_t total[256];
+
+    constexpr ByteExcess() : min(), total() {
+        for (int x = 0; x < 256; x++) {
+            int e = 0, m = 8;
+            for (int j = 0; j < 8; j++) {
+                e += (x >> j & 1) ? 1 : -1;
+                m = std::min(m, e);
+            }
+            min[x] = (int8_t)m;
+            total[x] = (int8_t)e;
+        }
+    }
+};
+static constexpr ByteExcess byte_excess;
+
+BalancedParentheses::BalancedParentheses(BitVector _bits) :
+    bits(std::move(_bits)) {
+    bits.build();
+    auto W = (bits.size() + 63) / 64;
+    auto B = (W + block_words - 1) / block_words;
+    leaves = 1;
+    while (leaves < B) leaves *= 2;
+
+    // (the positions past the end count as open parentheses)
+    min_excess.assign(2 * leaves, INT32_MAX / 2);
+    for (size_t b = 0; b < B; b++) {
+        int64_t e = 0, m = INT32_MAX / 2;
+        for (auto w = b * block_words; w < std::min(W, (b + 1) * block_words); w++) {
+            m = std::min(m, e + word_min(w));
+            e += (int64_t)std::popcount(bits.word(w)) * 2 - 64;
+        }
+        min_excess[leaves + b] = (int32_t)m;
+    }
+    for (auto v = leaves - 1; v >= 1; v--) {
+        // the children cover [a, mid) and [mid, b) where the blocks are numbered in order
+        size_t a = v, b = v + 1;
+        while (a < leaves) {
+            a *= 2;
+            b *= 2;
+        }
+        a -= leaves;
+        b -= leaves;
+        auto mid = (a + b) / 2;
+        auto right = min_excess[2 * v + 1];
+        if (mid < B) {
+            right += (int32_t)(excess_before(mid * block_words) - excess_before(a * block_words));
+        }
+        min_excess[v] = std::min(min_excess[2 * v], right);
+    }
+
+    leaf_ranks.assign(B + 1, 0);
+    for (size_t w = 0; w < W; w++) {
+        leaf_ranks[w / block_words + 1] += (uint64_t)std::popcount(leaf_word(w));
+    }
+    for (size_t b = 1; b < leaf_ranks.size(); b++) leaf_ranks[b] += leaf_ranks[b - 1];
+}
+
+int64_t BalancedParentheses::word_min(size_t w) const {
+    auto x = bits.word(w);
+    if ((w + 1) * 64 > bits.size()) x |= ~(uint64_t)0 << (bits.size() % 64);
+    int64_t e = 0, m = 64;
+    for (int k = 0; k < 64; k += 8) {
+        auto byte = (unsigned)(x >> k & 0xff);
+        m = std::min(m, e + byte_excess.min[byte]);
+        e += byte_excess.total[byte];
+    }
+    return m;
+}
+
+uint64_t BalancedParentheses::leaf_word(size_t w) const {
+    // an open parenthesis whose next bit (the lowest bit of the next word for the last one) is a close
+    auto x = bits.word(w);
+    uint64_t next = (w + 1) * 64 < bits.size() ? bits.word(w + 1) & 1 : 0;
+    return x & ~(x >> 1 | next << 63);
+}
+
+// the first block b >= from (within [a, b), the blocks of node v) where the excess reaches target
+int64_t BalancedParentheses::find_first(size_t v, size_t a, size_t b, size_t from, int64_t target) const {
+    auto B = leaf_ranks.size() - 1;
+    if (b <= from || a >= B) return -1;
+    if (a >= from && excess_before(a * block_words) + min_excess[v] > target) return -1;
+    if (b - a == 1) return (int64_t)a;
+    auto mid = (a + b) / 2;
+    auto found = find_first(2 * v, a, mid, from, target);
+    if (found >= 0) return found;
+    return find_first(2 * v + 1, mid, b, from, target);
+}
+
+// the last block b < to (within [a, b), the blocks of node v) where the excess reaches target
+int64_t BalancedParentheses::find_last(size_t v, size_t a, size_t b, size_t to, int64_t target) const {
+    auto B = leaf_ranks.size() - 1;
+    if (a >= to || a >= B) return -1;
+    if (b <= to && excess_before(a * block_words) + min_excess[v] > target) return -1;
+    if (b - a == 1) return (int64_t)a;
+    auto mid = (a + b) / 2;
+    auto found = find_last(2 * v + 1, mid, b, to, target);
+    if (found >= 0) return found;
+    return find_last(2 * v, a, mid, to, target);
+}
+
+size_t BalancedParentheses::fwd_search(size_t i, int64_t d) const {
+    auto W = (bits.size() + 63) / 64;
+    auto e = excess(i);
+    auto target = e + d;
+    // the rest of the word of i
+    for (auto j = i + 1; j < bits.size() && j % 64 != 0; j++) {
+        e += bits.get(j) ? 1 : -1;
+        if (e == target) return j;
+    }
+    // the rest of the block of i, then the first block after it reaching the target
+    auto w = i / 64 + 1;
+    auto end = std::min(W, (i / 64 / block_words + 1) * block_words);
+    if (w < end) e = excess_before(w);
+    for (; w < end; w++) {
+        if (e + word_min(w) <= target) break;
+        e += (int64_t)std::popcount(bits.word(w)) * 2 - 64;
+    }
+    if (w == end) {
+        auto b = find_first(1, 0, leaves, i / 64 / block_words + 1, target);
+        assert(b >= 0);
+        w = (size_t)b * block_words;
+        e = excess_before(w);
+        for (; e + word_min(w) > target; w++) e += (int64_t)std::popcount(bits.word(w)) * 2 - 64;
+    }
+    for (auto j = w * 64;; j++) {
+        e += bits.get(j) ? 1 : -1;
+        if (e == target) return j;
+    }
+}
+
+int64_t BalancedParentheses::bwd_search(size_t i, int64_t d) const {
+    auto e = excess(i);
+    auto target = e + d;
+    // the positions before i in the word of i, e becomes excess(j-1)
+    for (auto j = i; j % 64 != 0; j--) {
+        e -= bits.get(j) ? 1 : -1;
+        if (e == target) return (int64_t)j - 1;
+    }
+    // the earlier words of the block of i, then the last block before it reaching the target
+    auto w = i / 64;
+    auto begin = i / 64 / block_words * block_words;
+    bool found = false;
+    while (w > begin) {
+        w--;
+        e = excess_before(w);
+        if (e + word_min(w) <= target) {
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        auto b = find_last(1, 0, leaves, i / 64 / block_words, target);
+        if (b < 0) {
+            assert(target == 0);
+            return -1;
+        }
+        w = ((size_t)b + 1) * block_words;
+        do {
+            w--;
+            e = excess_before(w);
+        } while (e + word_min(w) > target);
+    }
+    // the last position of the word where the excess is target
+    int64_t last = -1;
+    for (auto j = w * 64; j < w * 64 + 64 && j < bits.size(); j++) {
+        e += bits.get(j) ? 1 : -1;
+        if (e == target) last = (int64_t)j;
+    }
+    return last;
+}
+
+size_t BalancedParentheses::leaf_rank(size_t i) const {
+    auto w = i / 64;
+    size_t r = leaf_ranks[w / block_words];
+    for (auto v = w / block_words * block_words; v < w; v++) r += (size_t)std::popcount(leaf_word(v));
+    if (i % 64) r += (size_t)std::popcount(leaf_word(w) & (((uint64_t)1 << (i % 64)) - 1));
+    return r;
+}
+
+size_t BalancedParentheses::leaf_select(size_t j) const {
+    // the last block with fewer than j+1 leaves before it, then word by word
+    size_t lo = 0, hi = leaf_ranks.size() - 1;
+    while (hi - lo > 1) {
+        auto mid = (lo + hi) / 2;
+        if (leaf_ranks[mid] <= j) lo = mid;
+        else hi = mid;
+    }
+    j -= leaf_ranks[lo];
+    auto w = lo * block_words;
+    for (;; w++) {
+        auto count = (size_t)std::popcount(leaf_word(w));
+        if (j < count) break;
+        j -= count;
+    }
+    auto word = leaf_word(w);
+    for (; j > 0; j--) word &= word - 1;
+    return w * 64 + (size_t)std::countr_zero(word);
+}
+
+size_t BalancedParentheses::size_in_bytes() const {
+    return bits.size_in_bytes() + min_excess.size() * sizeof(int32_t) + leaf_ranks.size() * sizeof(uint64_t);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// a bit vector with constant time rank and logarithmic time select
+// (cumulative counts every 512 bits, i.e., 12.5% on top of the bits)
+class BitVector {
+private:
+    std::vector<uint64_t> words;
+    // ranks[b] = the number of ones before the b-th block of 8 words
+    std::vector<uint64_t> ranks;
+    size_t n;
+
+public:
+    BitVector(size_t _n = 0);
+
+    void set(size_t i) { words[i / 64] |= (uint64_t)1 << (i % 64); }
+    bool get(size_t i) const { return words[i / 64] >> (i % 64) & 1; }
+    uint64_t word(size_t w) const { return words[w]; }
+    size_t size() const { return n; }
+
+    // must be called after the last `set` and before any rank or select
+    void build();
+    // the number of ones in [0, i)
+    size_t rank1(size_t i) const;
+    size_t rank0(size_t i) const { return i - rank1(i); }
+    // the position of the j-th one (counting from 0)
+    size_t select1(size_t j) const;
+
+    size_t size_in_bytes() const;
+};
+
+
+// fixed-width unsigned integers packed into 64-bit words, the width being that of the largest value
+class IntVector {
+private:
+    // (one spare word, so that a value straddling two words can always read the second one)
+    std::vector<uint64_t> words;
+    size_t n;
+    unsigned width;
+
+public:
+    IntVector(size_t _n = 0, uint64_t max = 0);
+
+    uint64_t get(size_t i) const;
+    void set(size_t i, uint64_t x);
+    size_t size() const { return n; }
+
+    size_t size_in_bytes() const;
+};
+
+
+// a Huffman-shaped wavelet tree over the bytes of a string: every byte follows its Huffman code down the tree,
+// so the string takes about its zero-order entropy in bits per byte (plus the rank counts of the bit vectors),
+// and access and rank cost one bit vector operation per bit of the code
+class WaveletTree {
+private:
+    // child[b] = the node below for bit b, or -1 - c for the leaf of byte c
+    struct Node {
+        BitVector bits;
+        int32_t child[2];
+    };
+    std::vector<Node> nodes;
+    // the code of each byte (read from its lowest bit, from the root down) and its length (0 if the byte is absent),
+    // a string of a single distinct byte has no nodes at all
+    uint64_t codes[256];
+    uint8_t lengths[256];
+    int16_t only;
+    size_t n;
+
+public:
+    WaveletTree() : WaveletTree(std::string_view{}) {}
+    WaveletTree(std::string_view s);
+
+    unsigned char access(size_t k) const;
+    // the number of occurrences of c in [0, k)
+    size_t rank(unsigned char c, size_t k) const;
+
+    size_t size_in_bytes() const;
+};
+
+
+// a balanced parentheses sequence (1 = open, 0 = close) with a range min tree over the excess,
+// a node is represented by the position of its open parenthesis
+class BalancedParentheses {
+private:
+    BitVector bits;
+    // min_excess[v] = the minimum excess reached within the blocks of segment tree node v,
+    // relative to the excess before them (the leaves are the blocks of 8 words, from index `leaves` on)
+    std::vector<int32_t> min_excess;
+    size_t leaves;
+    // leaf_ranks[b] = the number of leaves ("10") starting before the b-th block of 8 words
+    std::vector<uint64_t> leaf_ranks;
+
+    // the excess before the w-th word
+    int64_t excess_before(size_t w) const { return 2 * (int64_t)bits.rank1(w * 64) - (int64_t)(w * 64); }
+    // the minimum excess reached within the w-th word, relative to the excess before it
+    // (the positions past the end count as open parentheses)
+    int64_t word_min(size_t w) const;
+    // the bits of the w-th word that start a leaf
+    uint64_t leaf_word(size_t w) const;
+    int64_t find_first(size_t v, size_t a, size_t b, size_t from, int64_t target) const;
+    int64_t find_last(size_t v, size_t a, size_t b, size_t to, int64_t target) const;
+
+public:
+    BalancedParentheses() : leaves(0) {}
+    BalancedParentheses(BitVector _bits);
+
+    bool is_open(size_t i) const { return bits.get(i); }
+    size_t size() const { return bits.size(); }
+    size_t rank1(size_t i) const { return bits.rank1(i); }
+    // (the number of open minus close parentheses in [0, i])
+    int64_t excess(size_t i) const { return 2 * (int64_t)bits.rank1(i + 1) - (int64_t)(i + 1); }
+
+    // the smallest j > i with excess(j) = excess(i) + d
+    size_t fwd_search(size_t i, int64_t d) const;
+    // the largest j < i with excess(j) = excess(i) + d, or -1 (where the excess is 0)
+    int64_t bwd_search(size_t i, int64_t d) const;
+
+    size_t find_close(size_t i) const { return fwd_search(i, -1); }
+    // the parent of node i (i must not be the root)
+    size_t enclose(size_t i) const { return (size_t)(bwd_search(i, -2) + 1); }
+
+    // the number of leaves (open parentheses followed by a close one) starting in [0, i)
+    size_t leaf_rank(size_t i) const;
+    // the position of the j-th leaf (counting from 0)
+    size_t leaf_select(size_t j) const;
+
+    size_t size_in_bytes() const;
+};
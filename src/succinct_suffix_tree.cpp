@@ -0,0 +1,217 @@
+#include "./succinct_suffix_tree.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <algorithm> // std::min
+#include <vector>
+#include <stdexcept>
+
+
+
+// ==========================================================================================
+//                                  navigation
+// ==========================================================================================
+
+/*
+the children of the node at position p are found by walking its child list in the parentheses:
+the first child opens at p+1 and the next sibling of a child q opens right after find_close(q),
+the list ending at the close parenthesis of p; as the children are sorted, a walk can stop at the first larger character
+*/
+
+// whether node v has a leaf child whose edge starts with c
+bool SuccinctSuffixTree::has_leaf(size_t v, char c) const {
+    for (auto k = leaf_offsets.get(v); k < leaf_offsets.get(v + 1); k++) {
+        auto y = leaf_char(v, k);
+        if (y == c) return true;
+        if (y > c) break;
+    }
+    return false;
+}
+
+std::pair<std::optional<size_t>, index_t> SuccinctSuffixTree::find_internal_node(std::string_view s) const {
+    size_t p = 0; // start from the root
+    index_t i = 0; // at each iteration, search for s[i:]
+    while (true) {
+        // all characters in s have been matched: s exists and its is an internal node
+        if (i >= s.size()) return {p, (index_t)(i - s.size())};
+
+        auto d = depth.get(id(p));
+        std::optional<size_t> child;
+        for (auto q = p + 1; bp.is_open(q); q = bp.find_close(q) + 1) {
+            auto c = txt[label.get(id(q)) + d];
+            if (c == s[i]) child = q;
+            if (c >= s[i]) break;
+        }
+        // the traversal leads to a leaf node (s is unique), or s doesn't exist
+        if (!child) return {std::nullopt, has_leaf(id(p), s[i]) ? 1 : 0};
+
+        auto v = id(*child);
+        // the number of characters need to be compared for this edge
+        auto len = std::min((size_t)depth.get(v), s.size()) - i;
+        // mismatch: s doesn't exist
+        if (s.substr(i, len) != std::string_view(txt).substr(label.get(v) + i, len)) return {std::nullopt, 0};
+        p = *child;
+        i = (index_t)depth.get(v);
+    }
+    assert(false);
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+
+// compute the net frequency of a single substring s, as in SuffixTree::single_nf
+index_t SuccinctSuffixTree::single_nf(std::string_view s) const {
+    auto [S, left_len_S] = find_internal_node(s);
+    // s doesn't exist, or is unique, or is non-branching
+    if (!S || left_len_S != 0) return 0;
+
+    auto v = id(*S);
+    auto nf = (index_t)(leaf_offsets.get(v + 1) - leaf_offsets.get(v));
+    // no leaf children
+    if (nf == 0) return 0;
+    // for each repeated left extension xS, and each of its leaves xSy
+    for (auto w = weiner_offsets.get(v); w < weiner_offsets.get(v + 1); w++) {
+        auto xS = weiner_targets.get(w);
+        for (auto k = leaf_offsets.get(xS); k < leaf_offsets.get(xS + 1); k++) {
+            // if Sy is a leaf
+            if (has_leaf(v, leaf_char(xS, k))) nf--;
+        }
+    }
+    return nf;
+}
+
+
+// compute the net frequencies for all the branching substrings, as in SuffixTree::all_nf:
+// the nodes are visited in preorder, which is simply the order of the arrays
+void SuccinctSuffixTree::all_nf() const {
+    auto m = depth.size();
+    std::vector<index_t> nf(m, 0);
+    for (size_t v = 1; v < m; v++) {
+        auto first = leaf_offsets.get(v), last = leaf_offsets.get(v + 1);
+        nf[v] += (index_t)(last - first);
+        auto S = suffix_link.get(v);
+        for (auto k = first; k < last; k++) {
+            if (has_leaf(S, leaf_char(v, k))) nf[S]--;
+        }
+    }
+
+    for (size_t v = 1; v < m; v++) {
+        if (nf[v]) {
+            std::cout << std::string_view(txt).substr(label.get(v), depth.get(v))
+                      << '\t' << nf[v] << std::endl;
+        }
+    }
+}
+
+
+
+
+// ==========================================================================================
+//                                  other functions
+// ==========================================================================================
+
+
+// succinct suffix tree constructor, via a suffix tree that is only traversed (so without weiner links)
+SuccinctSuffixTree::SuccinctSuffixTree(std::string_view _txt) :
+    txt(_txt) {
+    SuffixTree tree{txt, SuffixTree::Options::for_all_nf()};
+    build(tree);
+}
+
+SuccinctSuffixTree::SuccinctSuffixTree(const SuffixTree& tree) :
+    txt(tree.text()) {
+    // (the queries assume every suffix has its leaf and every internal node its full depth)
+    if (!tree.complete()) {
+        throw std::logic_error("SuccinctSuffixTree: a sparse or truncated suffix tree cannot be copied");
+    }
+    build(tree);
+}
+
+void SuccinctSuffixTree::build(const SuffixTree& tree) {
+    using InternalNode = SuffixTree::InternalNode;
+
+    // the nodes in preorder with their children sorted (pushed largest first), and their parentheses
+    std::vector<const InternalNode*> nodes;
+    std::vector<bool> parens;
+    // ids[node->id] = the preorder id of the node
+    std::vector<index_t> ids(tree.internal_nodes());
+    std::vector<std::pair<const InternalNode*, bool>> stack{{tree.root.get(), false}};
+    while (!stack.empty()) {
+        auto [node, closing] = stack.back();
+        stack.pop_back();
+        parens.push_back(!closing);
+        if (closing) continue;
+        ids[node->id] = (index_t)nodes.size();
+        nodes.push_back(node);
+        stack.push_back({node, true});
+        auto children = tree.children(node);
+        for (auto child = children.rbegin(); child != children.rend(); child++) {
+            if (!child->second.is_leaf()) stack.push_back({child->second.node(), false});
+        }
+    }
+    BitVector bits(parens.size());
+    for (size_t i = 0; i < parens.size(); i++) {
+        if (parens[i]) bits.set(i);
+    }
+    bp = BalancedParentheses(std::move(bits));
+
+    auto n = txt.size(), m = nodes.size();
+    size_t leaf_count = 0, link_count = 0;
+    std::vector<index_t> links(m + 1, 0);
+    // the leaf children of the nodes in preorder, sorted by their first characters
+    std::vector<index_t> suffixes;
+    std::vector<size_t> leaf_starts;
+    for (auto node : nodes) {
+        leaf_starts.push_back(suffixes.size());
+        for (auto& [_, child] : tree.children(node)) {
+            if (child.is_leaf()) suffixes.push_back(child.suffix());
+        }
+        if (node->suffix_link != nullptr) {
+            link_count++;
+            links[ids[node->suffix_link->id] + 1]++;
+        }
+    }
+    leaf_count = suffixes.size();
+
+    label = IntVector(m, n);
+    depth = IntVector(m, n);
+    suffix_link = IntVector(m, m);
+    leaf_offsets = IntVector(m + 1, leaf_count);
+    leaves = IntVector(leaf_count, n);
+    for (size_t v = 0; v < m; v++) {
+        auto node = nodes[v];
+        label.set(v, node->end - node->depth);
+        depth.set(v, node->depth);
+        if (node->suffix_link != nullptr) suffix_link.set(v, ids[node->suffix_link->id]);
+        leaf_offsets.set(v, leaf_starts[v]);
+    }
+    leaf_offsets.set(m, leaf_count);
+    for (size_t k = 0; k < leaf_count; k++) {
+        leaves.set(k, suffixes[k]);
+    }
+
+    // the weiner links, by reversing the suffix links (see SuffixTree::reverse_suffix_links)
+    for (size_t v = 0; v < m; v++) {
+        links[v + 1] += links[v];
+    }
+    weiner_offsets = IntVector(m + 1, link_count);
+    weiner_targets = IntVector(link_count, m);
+    for (size_t v = 0; v <= m; v++) {
+        weiner_offsets.set(v, links[v]);
+    }
+    for (size_t v = 0; v < m; v++) {
+        if (nodes[v]->suffix_link == nullptr) continue;
+        weiner_targets.set(links[ids[nodes[v]->suffix_link->id]]++, v);
+    }
+}
+
+size_t SuccinctSuffixTree::size_in_bytes() const {
+    return txt.size() + bp.size_in_bytes() + label.size_in_bytes() + depth.size_in_bytes()
+         + suffix_link.size_in_bytes() + leaf_offsets.size_in_bytes() + leaves.size_in_bytes()
+         + weiner_offsets.size_in_bytes() + weiner_targets.size_in_bytes();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "./succinct.hpp"
+#include "./suffix_tree.hpp"
+
+#include <string_view>
+#include <string>
+#include <optional>
+#include <utility> // std::pair
+#include <cstdint>
+
+
+// a read-only copy of a built SuffixTree without any pointers or hash maps:
+// the internal nodes form a balanced parentheses sequence in preorder, the children of every node
+// being sorted by their first character (leaves stay implicit, as in SuffixTree),
+// and the fields of the node with preorder id v (the rank of its open parenthesis) are packed integer arrays
+class SuccinctSuffixTree {
+private:
+    std::string txt;
+    BalancedParentheses bp;
+    // the path label of node v is txt[label[v] ... label[v] + depth[v])
+    IntVector label, depth;
+    IntVector suffix_link;
+    // the leaf children of node v are the suffixes leaves[leaf_offsets[v] ... leaf_offsets[v+1]),
+    // sorted by their first character txt[suffix + depth[v]]
+    IntVector leaf_offsets, leaves;
+    // the weiner links of node v are weiner_targets[weiner_offsets[v] ... weiner_offsets[v+1])
+    IntVector weiner_offsets, weiner_targets;
+
+    void build(const SuffixTree& tree);
+    size_t id(size_t p) const { return bp.rank1(p); }
+    // the first character of the edge below node v that leads to leaf k
+    char leaf_char(size_t v, size_t k) const { return txt[leaves.get(k) + depth.get(v)]; }
+    bool has_leaf(size_t v, char c) const;
+
+public:
+    // constructor, the text must end with a unique terminator (the suffix tree is only kept while copying it)
+    SuccinctSuffixTree(std::string_view _txt);
+    // copy a suffix tree built elsewhere (throws std::logic_error for a sparse or truncated one)
+    SuccinctSuffixTree(const SuffixTree& tree);
+
+    // see SuffixTree::find_internal_node, a node being the position of its open parenthesis
+    std::pair<std::optional<size_t>, index_t> find_internal_node(std::string_view s) const;
+
+    index_t single_nf(std::string_view s) const;
+
+    void all_nf() const;
+
+    std::string_view text() const { return txt; }
+    size_t size_in_bytes() const;
+};
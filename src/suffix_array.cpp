@@ -0,0 +1,185 @@
+#include "./suffix_array.hpp"
+#include "./parallel.hpp"
+
+#include <assert.h>
+#include <iostream>
+#include <algorithm> // std::max
+#include <utility> // std::pair
+#include <type_traits> // std::conditional_t
+
+
+
+// ==========================================================================================
+//                                  construction related
+// ==========================================================================================
+
+/*
+
+suffix sorting by prefix doubling (Manber and Myers), every step of a round is parallel:
+ - after the round for h, rank[i] identifies txt[i...i+h) among all the length-h prefixes of suffixes;
+ - the next round sorts the suffixes by the pair (rank[i], rank[i+h]) with a parallel merge sort,
+   and re-ranks them with a parallel prefix sum over "differs from the previous pair";
+ - the rounds stop once all ranks are distinct
+the initial ranks pack the first three characters, so the first round already sorts by six characters
+
+LCP by the Phi algorithm (Kärkkäinen, Manzini and Puglisi), parallel over chunks of text positions:
+ - phi[sa[k]] = sa[k-1], and plcp[i] = lcp(i, phi[i]) is computed in text order,
+   using plcp[i] >= plcp[i-1] - 1 within a chunk (each chunk starts from 0);
+ - lcp[k] = plcp[sa[k]]
+*/
+
+void SuffixArray::build_sa() {
+    auto n = (index_t)txt.size();
+    sa.resize(n);
+    if (n == 0) return;
+
+    // (a missing character is 0, so a shorter prefix is smaller)
+    std::vector<index_t> rank(n);
+    parallel_for_blocked(n, threads, [&](size_t i) {
+        index_t key = 0;
+        for (size_t j = i; j < i + 3; j++) {
+            key = (key << 9) | (j < n ? (index_t)(unsigned char)txt[j] + 1 : 0);
+        }
+        rank[i] = key;
+    });
+
+    // the pair (rank[i], rank[i+h] + 1) packed into twice the width of a position
+    using Key = std::conditional_t<sizeof(index_t) == 4, uint64_t, unsigned __int128>;
+    constexpr int width = sizeof(index_t) * 8;
+    std::vector<std::pair<Key, index_t>> keys(n);
+    std::vector<index_t> new_rank(n);
+    for (index_t h = 3;; h *= 2) {
+        parallel_for_blocked(n, threads, [&](size_t i) {
+            Key second = i + h < n ? (Key)rank[i + h] + 1 : 0;
+            keys[i] = {(Key)rank[i] << width | second, (index_t)i};
+        });
+        parallel_sort(keys, threads, [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        parallel_for_blocked(n, threads, [&](size_t k) {
+            sa[k] = keys[k].second;
+            new_rank[k] = k > 0 && keys[k].first != keys[k - 1].first;
+        });
+        parallel_prefix_sum(new_rank, threads);
+        parallel_for_blocked(n, threads, [&](size_t k) {
+            rank[sa[k]] = new_rank[k];
+        });
+
+        if (new_rank[n - 1] == n - 1 || h >= n) break;
+    }
+}
+
+void SuffixArray::build_lcp() {
+    auto n = (index_t)txt.size();
+    lcp.assign(n, 0);
+    if (n == 0) return;
+
+    std::vector<index_t> phi(n);
+    phi[sa[0]] = n; // no preceding suffix
+    parallel_for_blocked(n - 1, threads, [&](size_t k) {
+        phi[sa[k + 1]] = sa[k];
+    });
+
+    // plcp overwrites phi, each chunk of text positions is processed by one thread
+    size_t chunks = std::max<size_t>(1, (size_t)n >> 16);
+    parallel_for(chunks, threads, [&](size_t c) {
+        index_t h = 0;
+        for (auto i = (index_t)(n * c / chunks); i < (index_t)(n * (c + 1) / chunks); i++) {
+            auto j = phi[i];
+            if (j == n) {
+                h = 0;
+            }
+            else {
+                while (i + h < n && j + h < n && txt[i + h] == txt[j + h]) h++;
+            }
+            phi[i] = h;
+            if (h > 0) h--;
+        }
+    });
+
+    parallel_for_blocked(n, threads, [&](size_t k) {
+        lcp[k] = k == 0 ? 0 : phi[sa[k]];
+    });
+}
+
+void SuffixArray::build_bwt() {
+    auto n = (index_t)txt.size();
+    bwt.assign(n, '\0');
+    primary = 0;
+    parallel_for_blocked(n, threads, [&](size_t k) {
+        if (sa[k] == 0) primary = (index_t)k;
+        else bwt[k] = txt[sa[k] - 1];
+    });
+}
+
+SuffixArray::SuffixArray(std::string_view _txt, unsigned _threads) :
+    txt(_txt),
+    threads(resolve_threads(_threads)) {
+    check_length(txt.size(), "SuffixArray");
+    build_sa();
+    build_lcp();
+    build_bwt();
+}
+
+
+
+
+// ==========================================================================================
+//                              net frequency related
+// ==========================================================================================
+
+/*
+
+the internal nodes of the suffix tree are the lcp-intervals [lb...rb] with lcp value d > 0,
+and a leaf child of such a node is a suffix whose deepest enclosing lcp-interval is the node,
+i.e., the k-th suffix is a leaf child of the interval of depth m[k] = max(lcp[k], lcp[k+1])
+
+let S be the node and i = sa[k], then Sy (y = txt[i+d]) is unique,
+and xS (x = txt[i-1]) is unique iff the shortest unique prefix of suffix i-1 is at most d+1 long,
+i.e., iff m(i-1) <= m(i) (writing m(i) for m at the position of suffix i in the suffix array),
+so the net frequency of S is the number of its leaf children for which m(i-1) <= m(i)
+
+the sweep then follows the usual bottom-up traversal of the lcp-intervals with a stack
+(Abouelhoda, Kurtz and Ohlebusch), each suffix adding its flag to its deepest enclosing interval
+*/
+
+void SuffixArray::all_nf() {
+    auto n = (index_t)txt.size();
+    if (n == 0) return;
+
+    // m in text order, then the flags in suffix array order
+    std::vector<index_t> m(n);
+    parallel_for_blocked(n, threads, [&](size_t k) {
+        m[sa[k]] = std::max(lcp[k], k + 1 < n ? lcp[k + 1] : (index_t)0);
+    });
+    std::vector<uint8_t> flag(n);
+    parallel_for_blocked(n, threads, [&](size_t k) {
+        flag[k] = sa[k] == 0 || m[sa[k] - 1] <= m[sa[k]];
+    });
+
+    struct Interval {
+        index_t lcp, lb, nf;
+    };
+    std::vector<Interval> stack{{0, 0, 0}};
+    for (index_t k = 1; k <= n; k++) {
+        // the (k-1)-th suffix belongs to the deeper of the intervals
+        // on either side of its boundary with the k-th suffix
+        auto cur = k < n ? lcp[k] : 0;
+        auto lb = k - 1;
+        index_t nf = flag[k - 1];
+        if (cur <= stack.back().lcp) {
+            stack.back().nf += nf;
+            nf = 0;
+        }
+        while (cur < stack.back().lcp) {
+            auto S = stack.back();
+            stack.pop_back();
+            if (S.nf) {
+                std::cout << txt.substr(sa[S.lb], S.lcp) << '\t' << S.nf << std::endl;
+            }
+            lb = S.lb;
+        }
+        if (cur > stack.back().lcp) {
+            stack.push_back({cur, lb, nf});
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string_view>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "./index.hpp"
+
+
+// suffix array, LCP array and BWT of a text, each stage built in parallel,
+// followed by a (sequential) sweep over the LCP intervals that computes all net frequencies
+// (positions are index_t; the prefix doubling needs about 44 bytes per character at its peak,
+//  88 with -DNF_INDEX64: the 16-byte (key, suffix) pairs and the merge buffer of the same size,
+//  plus rank, new_rank and sa)
+class SuffixArray {
+private:
+    // the input text
+    std::string_view txt;
+    unsigned threads;
+
+    void build_sa();
+    void build_lcp();
+    void build_bwt();
+
+public:
+    // sa[k] = the starting position of the k-th smallest suffix
+    // (a suffix that is a prefix of another suffix is the smaller one)
+    std::vector<index_t> sa;
+    // lcp[k] = the length of the longest common prefix of the suffixes sa[k-1] and sa[k] (lcp[0] = 0)
+    std::vector<index_t> lcp;
+    // bwt[k] = txt[sa[k]-1], the character preceding the k-th suffix,
+    // except for bwt[primary] (the suffix sa[primary] = 0 has no preceding character) which is '\0'
+    std::string bwt;
+    index_t primary;
+
+    // constructor, `_threads` = 0 uses all cores
+    // (throws std::length_error if the text does not fit in index_t)
+    SuffixArray(std::string_view _txt, unsigned _threads = 0);
+
+    // compute and print the net frequencies of all the branching substrings
+    void all_nf();
+
+    std::string_view text() const { return txt; }
+};
@@ -2,11 +2,16 @@
 
 #include <assert.h>
 #include <iostream>
-#include <functional>
 #include <algorithm> // std::find, std::min
 #include <unordered_set>
 #include <iomanip> 
 #include <fstream>
+#include <stdexcept>
+#include <numeric> // std::iota
+#include <limits>
+#include <functional> // std::less
+
+#include "./parallel.hpp"
 
 
 
@@ -16,21 +21,58 @@
 
 
 
+// the edges are in the dense arrays, or in the edge table, or in the double array once the tree is frozen
+const SuffixTree::Child* SuffixTree::child(const InternalNode* node, char c) const {
+    if (dense) return dense_edges.find(node->id, c);
+    return frozen ? frozen_edges.find(node->id, c) : edges.find(node->id, c);
+}
+
+template <typename F>
+void SuffixTree::for_each_edge(F f) const {
+    if (dense) dense_edges.for_each(f);
+    else if (frozen) frozen_edges.for_each(f);
+    else edges.for_each(f);
+}
+
+
 // compute the net frequency of a single substring s
-uint32_t SuffixTree::single_nf(std::string_view s) {
+index_t SuffixTree::single_nf(std::string_view s) {
+    if (s.size() + 2 > depth_bound) {
+        throw std::out_of_range("SuffixTree::single_nf: the tree is truncated below this length");
+    }
     auto [S, left_len_S] = find_internal_node(s);
     // s doesn't exist, or is unique, or is non-branching
     if (S == nullptr || left_len_S != 0) return 0;
 
+    // in a sparse tree, the occurrences of s with a unique right extension Sy are the leaves below S,
+    // each one counting if its left extension is unique too
+    if (sparse) {
+        index_t nf = 0;
+        for (auto y : alphabet) {
+            auto Sy = child(S, y);
+            if (Sy != nullptr && Sy->is_leaf() && left_unique(Sy->suffix(), S->depth)) nf++;
+        }
+        return nf;
+    }
+    // lazy weiner links are derived from the suffix links on the first query (the edges are left as they are)
+    if (lazy_weiner_links && weiner_offsets.empty()) reverse_suffix_links();
+
+    // the unique right extensions Sy of s
+    std::string ys;
+    for (auto y : alphabet) {
+        auto Sy = child(S, y);
+        if (Sy != nullptr && Sy->is_leaf()) ys.push_back(y);
+    }
     // initialise the net frequency to the number of unique right extensions of s
-    uint32_t nf = (uint32_t)S->leaf_children.size();
+    auto nf = (index_t)ys.size();
     // no leaf children
     if (nf == 0) return 0;
     // for each repeated left extension xS
-    for (const auto& xS : S->weiner_links) {
-        for (const auto& [y, _] : xS->leaf_children) {
-            // if Sy is a leaf
-            if (S->leaf_children.contains(y)){
+    for (const auto& xS : weiner_links_of(S)) {
+        for (auto y : ys) {
+            // if xSy is a leaf
+            auto xSy = child(xS, y);
+            if (xSy != nullptr && xSy->is_leaf()) {
                 nf--;
             }
         }
@@ -39,44 +81,42 @@ uint32_t SuffixTree::single_nf(std::string_view s) {
 }
 
 
-// compute the net frequencies for all the branching substrings
+// compute the net frequencies for all the branching substrings:
+// every leaf edge xSy adds one to xS, and takes one from S = link(xS) if Sy is a leaf too
+// (one pass over the edges, the nodes being reached by their ids)
 void SuffixTree::all_nf() {
+    for (auto S : by_id) {
+        S->nf = 0;
+    }
 
-    // a recursive function that processes each internal node
-    std::function<void(SuffixTree::InternalNode*)> process;
-    process = [&process](SuffixTree::InternalNode* xS) {
-        if (!xS->leaf_children.empty()) {
-            xS->nf += xS->leaf_children.size();
+    // (in a sparse tree, as in single_nf: every leaf counts for its parent if its left extension is unique)
+    if (sparse) {
+        for_each_edge([this](uint64_t id, char, Child Sy) {
+            if (id != 0 && Sy.is_leaf() && left_unique(Sy.suffix(), by_id[id]->depth)) by_id[id]->nf++;
+        });
+    }
+    else {
+        for_each_edge([this](uint64_t id, char y, Child xSy) {
+            if (id == 0 || !xSy.is_leaf()) return;
+            auto xS = by_id[id];
+            xS->nf++;
             auto S = xS->suffix_link;
-            for (auto& [y, _] : xS->leaf_children) {
-                if (S->leaf_children.contains(y)) {
-                    S->nf--;
-                }
+            auto Sy = child(S, y);
+            if (Sy != nullptr && Sy->is_leaf()) {
+                S->nf--;
             }
-        }
-        for (auto& [_, child] : xS->internal_children) {
-            process(child);
-        }
-    };
+        });
+    }
 
-    // a recursive function that prints each string of positive NF
-    std::function<void(SuffixTree::InternalNode*, uint32_t, uint32_t)> report;
-    report = [&report, this](SuffixTree::InternalNode* S, uint32_t start_pos, uint32_t string_depth) {
-        if (S->nf) {
-            std::cout << txt.substr(start_pos, string_depth)
+    // print each string of positive NF
+    // (the edge label is a suffix of the path label, so the string ends at `end`;
+    //  in a truncated tree, the nodes one character too deep are missing the leaves of their own left extensions)
+    for (size_t v = 1; v < by_id.size(); v++) {
+        auto S = by_id[v];
+        if (S->nf && S->depth + 2 <= depth_bound) {
+            std::cout << txt.substr(S->end - S->depth, S->depth)
                       << '\t' << S->nf << std::endl;
         }
-        for (auto& [_, child] : S->internal_children) {
-            report(child, start_pos, string_depth + child->edge_length());
-        }
-    };
-
-    for (auto& [_, xS] : root.get()->internal_children) {
-        process(xS);
-    }
-
-    for (auto& [_, S] : root.get()->internal_children) {
-        report(S, S->start, S->edge_length());
     }
 }
 
@@ -94,43 +134,57 @@ caveat: when the first return value is nullptr,
 b) return {nullptr, 0} if s doesn't exist, 
 a) return {nullptr, 1} if s is unique (its corresponding node is a leaf node)
 */
-std::pair<SuffixTree::InternalNode*, uint32_t> SuffixTree::find_internal_node(std::string_view s) {
+std::pair<SuffixTree::InternalNode*, index_t> SuffixTree::find_internal_node(std::string_view s) {
     auto node = root.get(); // start from the root
-    uint32_t i = 0; // at each iteration, search for s[i:]
+    index_t i = 0; // at each iteration, search for s[i:]
     while (true) {
         // all characters in s have been matched: s exists and its is an internal node
         if (i >= s.size()) return { node, i - s.size() };
 
-        auto internal_pair = node->internal_children.find(s[i]);
-        // if the traversal leads to an internal node
-        if (internal_pair != node->internal_children.end()) { 
-            auto internal_child = internal_pair->second;
-            // the number of characters need to be compared for this edge
-            auto len = std::min(internal_child->edge_length(), (uint32_t)s.size() - i);
-            
-            // match: go to this internal node
-            if (s.substr(i, len) == txt.substr(internal_child->start, len)) {
-                node = internal_child;
-                i += node->edge_length();
-            }
-            else { // mismatch: s doesn't exist
-                return {nullptr, 0};
-            }
+        auto next = child(node, s[i]);
+        // s doesn't exist
+        if (next == nullptr) return {nullptr, 0};
+        // the traversal leads to a leaf node: s corresponds to an leaf node
+        if (next->is_leaf()) return {nullptr, 1};
+
+        // the traversal leads to an internal node
+        auto internal_child = next->node();
+        // the number of characters need to be compared for this edge
+        auto len = std::min(internal_child->edge_length(), (index_t)s.size() - i);
+
+        // match: go to this internal node
+        if (s.substr(i, len) == txt.substr(internal_child->start, len)) {
+            node = internal_child;
+            i += node->edge_length();
         }
-        else { // the traversal leads to a leaf node
-            // s corresponds to an leaf node
-            if (node->leaf_children.contains(s[i])) {
-                return {nullptr, 1};
-            }
-            else { // s doesn't exist
-                return {nullptr, 0};
-            }
+        else { // mismatch: s doesn't exist
+            return {nullptr, 0};
         }
     }
     assert(false);
 }
 
 
+// whether the occurrence at the sampled position p of a string of length `depth` has a unique left extension in a sparse tree:
+// the string from the previous sampled position up to the end of the occurrence is unique iff its locus lies on the leaf edge
+// of that position, i.e., below the parent of the leaf (the first position has no left extension, which counts as unique)
+bool SuffixTree::left_unique(index_t p, index_t depth) const {
+    auto r = std::lower_bound(sparse_positions.begin(), sparse_positions.end(), p) - sparse_positions.begin();
+    if (r == 0) return true;
+    auto prev = sparse_positions[(size_t)r - 1];
+    return sparse_depths[(size_t)r - 1] < p - prev + depth;
+}
+
+
+// the children of a node, in the order of their first characters (one lookup per character of the alphabet)
+std::vector<std::pair<char, SuffixTree::Child>> SuffixTree::children(const InternalNode* node) const {
+    std::vector<std::pair<char, Child>> result;
+    for (auto c : alphabet) {
+        auto next = child(node, c);
+        if (next != nullptr) result.push_back({c, *next});
+    }
+    return result;
+}
 
 
 
@@ -161,7 +215,13 @@ trick 4 - rapid leaf extension (once a leaf, always a leaf)
 (resources: https://stackoverflow.com/a/9513423, https://brenden.github.io/ukkonen-animation/)
 */
 
-void SuffixTree::extend(uint32_t k) {
+void SuffixTree::extend(index_t k) {
+    logging = editable && k >= log_from;
+    if (logging) {
+        phase_starts.push_back(changes.size());
+        log({Change::Type::phase, active_node, nullptr, nullptr,
+             active_edge, active_length, remainder, '\0', false});
+    }
     need_link = nullptr;
     remainder++;
 
@@ -169,36 +229,32 @@ void SuffixTree::extend(uint32_t k) {
         if (active_length == 0) { // currently right at a node
             active_edge = k;
         }
-        // if leaf and internal children were not split,
-        // `Node* node = active_node->children.at(txt[active_edge]);`
-        // now we need figure out if `node` is a leaf or an internal node
-        auto node_leaf_pair = active_node->leaf_children.find(txt[active_edge]);
-        auto node_internal_pair = active_node->internal_children.find(txt[active_edge]);
-        bool is_leaf = (node_leaf_pair != active_node->leaf_children.end());
-        bool is_internal = (node_internal_pair != active_node->internal_children.end());
-        assert(!(is_leaf && is_internal));
+        // a single probe finds `node`, whether it is a leaf or an internal node
+        auto found = find_edge(active_node, txt[active_edge]);
 
         // rule 2b
-        if (!is_leaf && !is_internal) { // `node` doesn't exist   
-            LeafNode* leaf = new LeafNode(k, &global_end);
-            active_node->leaf_children[txt[active_edge]] = leaf;
+        if (found == nullptr) { // `node` doesn't exist
+            insert_edge(active_node->id, txt[active_edge], Child::leaf(k - active_node->depth));
+            log({Change::Type::leaf, active_node, nullptr, nullptr, 0, 0, 0, txt[active_edge], true});
             add_links(active_node);
         }
         else {
+            auto child = *found;
+            // the edge label of `node` starts at prev_start (a leaf edge ends at global_end)
+            auto prev_start = child.is_leaf() ? child.suffix() + active_node->depth : child.node()->start;
             // trick 1
-            auto len = is_leaf ? node_leaf_pair->second->edge_length() : node_internal_pair->second->edge_length();
+            auto len = child.is_leaf() ? global_end - prev_start : child.node()->edge_length();
 
             // keep walking down until len is strictly greater than active_length
             if (active_length >= len) {
-                assert(is_internal);
+                assert(!child.is_leaf());
                 active_edge += len;
                 active_length -= len;
-                active_node = node_internal_pair->second;
+                active_node = child.node();
                 // while walking down we might also need to handle the previous situations, so we continue
                 continue;
             }
             // rule 3
-            auto prev_start = is_leaf ? node_leaf_pair->second->start : node_internal_pair->second->start;
             if (txt[prev_start + active_length] == txt[k]) {
                 active_length++;
                 add_links(active_node);
@@ -217,39 +273,22 @@ void SuffixTree::extend(uint32_t k) {
                  /                      @ node
                                        /
             */
-            // split the edge
-            // (could combine the following two cases but excessive use of ternary is needed)
-            if (is_leaf) {
-                auto node = node_leaf_pair->second;
-                node->start += active_length;
-                
-                InternalNode* internal_node = new InternalNode(prev_start, node->start);
-                LeafNode* leaf = new LeafNode(k, &global_end);
-                internal_node->leaf_children[txt[k]] = leaf;
-                
-                active_node->internal_children[txt[active_edge]] = internal_node;
-                internal_node->leaf_children[txt[node->start]] = node;
-                // `node` becomes a leaf child of 'internal_node',
-                // which means it's no longer a leaf child of `active_node`
-                // (average case O(1) for `erase`)
-                active_node->leaf_children.erase(node_leaf_pair);
-                add_links(internal_node);
-            }
-            else if (is_internal) {
-                auto node = node_internal_pair->second;
-                node->start += active_length;
-                
-                InternalNode* internal_node = new InternalNode(prev_start, node->start);
-                LeafNode* leaf = new LeafNode(k, &global_end);
-                internal_node->leaf_children[txt[k]] = leaf;
-
-                active_node->internal_children[txt[active_edge]] = internal_node;
-                internal_node->internal_children[txt[node->start]] = node;
-                // `node` becomes an internal child of 'internal_node',
-                // which means it's no longer an internal child of `active_node`,
-                // but we don't need to do anything because it's replaced by `internal_node` already
-                add_links(internal_node);
-            }
+            // split the edge: `internal_node` takes the place of `node` below `active_node`
+            // (overwritten through `found` before any insertion can move the entry)
+            auto depth = active_node->depth + active_length;
+            InternalNode* internal_node = new_node(prev_start, prev_start + active_length, depth);
+            *found = Child::internal(internal_node);
+            auto c = txt[prev_start + active_length];
+            // the first characters of the two edges below `internal_node`, for the rollback
+            auto chars = (index_t)((unsigned char)txt[k] << 8 | (unsigned char)c);
+            insert_edge(internal_node->id, txt[k], Child::leaf(k - depth));
+            // `node` moves below 'internal_node': a leaf keeps its suffix, an internal node loses the head of its edge label
+            auto is_leaf = child.is_leaf();
+            if (!is_leaf) child.node()->start += active_length;
+            insert_edge(internal_node->id, c, child);
+            log({Change::Type::split, active_node, internal_node, is_leaf ? nullptr : child.node(),
+                 is_leaf ? 0 : prev_start, is_leaf ? child.suffix() : 0, chars, txt[active_edge], is_leaf});
+            add_links(internal_node);
         }
         remainder--;
 
@@ -277,10 +316,16 @@ void SuffixTree::add_links(InternalNode* node) {
     // add a suffix link from need_link to node
     // add a weiner link from node to need_link
     if (need_link != nullptr) {
-        need_link->suffix_link = node;
-        auto wls = node->weiner_links;
-        if (std::find(wls.begin(), wls.end(), need_link) == wls.end()) {
-            node->weiner_links.push_back(need_link);
+        if (need_link->suffix_link != node) {
+            log({Change::Type::suffix_link, need_link, nullptr, need_link->suffix_link, 0, 0, 0, '\0', false});
+            need_link->suffix_link = node;
+        }
+        if (!lazy_weiner_links) {
+            auto& wls = building_links[node->id];
+            if (std::find(wls.begin(), wls.end(), need_link) == wls.end()) {
+                wls.push_back(need_link);
+                log({Change::Type::weiner_link, node, nullptr, nullptr, 0, 0, 0, '\0', false});
+            }
         }
     }
     need_link = node;
@@ -289,40 +334,774 @@ void SuffixTree::add_links(InternalNode* node) {
 
 
 
+// ==========================================================================================
+//                          parallel (top-down) construction related
+// ==========================================================================================
+
+/*
+
+high-level idea (write-only top-down construction, partitioned as in ERA/WaveFront):
+ - the suffixes below a node of string depth d are grouped by their (d+1)-th character,
+   a group of one suffix is a leaf, and a group of two or more suffixes is extended character by character
+   while all its suffixes agree, the string depth where they first disagree is the depth of the child node;
+ - the top of the tree (string depths below prefix_len) is built sequentially,
+   any group that reaches prefix_len is deferred, i.e., becomes an independent task;
+ - the tasks are built in parallel (each only touches its own subtree),
+   then their roots are stitched under their parents;
+ - a truncated tree is built in the same way, except that a group still agreeing at the depth bound
+   becomes a childless node at that depth (and gets no suffix link, as no NF computation follows it);
+ - suffix links are computed top-down afterwards:
+   if the edge label of v is txt[i...j) then link(v) is reached from link(parent(v)) 
+   by walking down along txt[i...j) (skip/count trick), 
+   or from the root along txt[i+1...j) if the parent of v is the root;
+ - weiner links are the reverse of suffix links
+
+(resources: Giegerich, Kurtz and Stoye, "Efficient implementation of lazy suffix trees";
+            Mansour et al., "ERA: efficient serial and parallel suffix tree construction")
+*/
+
+// the first string depth (>= depth, < cap) at which the suffixes in suffixes[lo...hi-1] disagree,
+// or cap if they agree all the way up to it
+index_t SuffixTree::extension(const index_t* suffixes, index_t lo, index_t hi, index_t depth, index_t cap) {
+    auto n = (index_t)txt.size();
+    for (; depth < cap; depth++) {
+        if (suffixes[lo] + depth >= n) return depth;
+        auto c = txt[suffixes[lo] + depth];
+        for (auto k = lo + 1; k < hi; k++) {
+            if (suffixes[k] + depth >= n || txt[suffixes[k] + depth] != c) return depth;
+        }
+    }
+    return cap;
+}
+
+// build the subtree below `node` (of string depth `depth`) from the suffixes in suffixes[lo...hi-1],
+// groups that would create a node of string depth >= defer_depth are appended to `deferred` instead,
+// and the edges are appended to `out` (the nodes have no ids yet)
+// (an explicit stack is used, the tree can be as deep as the text is long)
+void SuffixTree::build_top_down(Pool<InternalNode>& nodes, std::vector<Edge>& out, index_t* suffixes, InternalNode* node, index_t depth,
+                                index_t lo, index_t hi, index_t defer_depth, std::vector<Group>* deferred) {
+    std::vector<Group> stack{{node, depth, lo, hi, nullptr}};
+    while (!stack.empty()) {
+        auto [parent, d, l, h, _] = stack.back();
+        stack.pop_back();
+        // (a node at the depth bound is not expanded)
+        if (d >= depth_bound) continue;
+
+        std::sort(suffixes + l, suffixes + h, [this, d](index_t a, index_t b) {
+            return txt[a + d] < txt[b + d];
+        });
+        for (auto a = l; a < h;) {
+            auto c = txt[suffixes[a] + d];
+            auto b = a + 1;
+            while (b < h && txt[suffixes[b] + d] == c) b++;
+
+            if (b - a == 1) {
+                out.push_back({parent, c, Child::leaf(suffixes[a])});
+            }
+            else {
+                auto child_depth = extension(suffixes, a, b, d + 1, std::min(defer_depth, depth_bound));
+                if (child_depth >= defer_depth) {
+                    deferred->push_back({parent, d, a, b, nullptr});
+                }
+                else {
+                    auto child = nodes.create(suffixes[a] + d, suffixes[a] + child_depth, child_depth);
+                    out.push_back({parent, c, Child::internal(child)});
+                    stack.push_back({child, child_depth, a, b, nullptr});
+                }
+            }
+            a = b;
+        }
+    }
+}
+
+// follow the path txt[i...j) down from `node`, the path must end at an internal node
+SuffixTree::InternalNode* SuffixTree::walk_down(InternalNode* node, index_t i, index_t j) {
+    while (i < j) {
+        node = child(node, txt[i])->node();
+        i += node->edge_length();
+    }
+    assert(i == j);
+    return node;
+}
+
+// compute the suffix links in the subtree of `node`, whose own suffix link is already set
+void SuffixTree::add_suffix_links(InternalNode* node) {
+    std::vector<InternalNode*> stack{node};
+    while (!stack.empty()) {
+        auto parent = stack.back();
+        stack.pop_back();
+        for (auto& [_, child] : children(parent)) {
+            if (child.is_leaf() || child.node()->depth >= depth_bound) continue;
+            auto below = child.node();
+            below->suffix_link = walk_down(parent->suffix_link, below->start, below->end);
+            stack.push_back(below);
+        }
+    }
+}
+
+
+
+
+// ==========================================================================================
+//                                  dynamic edits related
+// ==========================================================================================
+
+/*
+
+high-level idea:
+ - Ukkonen's algorithm is online, the tree after the k-th phase only depends on txt[0...k];
+ - an edit at position p leaves txt[0...p-1] untouched,
+   so the tree after phase p-1 is still valid for the edited text;
+ - every change made by the phases of the edit window (the last phases, from `log_from` on) is logged,
+   so for p in the window the phases p...n-1 can be undone in reverse order, and then redone on the edited text
+
+so the cost of a batch of edits is proportional to the length of the text after its leftmost edit,
+and edits close to the end of the text are much cheaper than a full rebuild;
+undoing and redoing costs more than building, so an edit before the window (which is at most half the text)
+rebuilds the tree instead, and the log never takes more than its window
+*/
+
+void SuffixTree::log(Change change) {
+    if (logging) changes.push_back(change);
+}
+
+void SuffixTree::trim_log(index_t k) {
+    auto phases = k - log_from;
+    if (phases == 0) return;
+    auto first = phase_starts[phases];
+    changes.erase(changes.begin(), changes.begin() + (std::ptrdiff_t)first);
+    phase_starts.erase(phase_starts.begin(), phase_starts.begin() + phases);
+    for (auto& start : phase_starts) start -= first;
+    log_from = k;
+}
+
+void SuffixTree::rollback(index_t k) {
+    assert(k >= log_from);
+    if (k - log_from >= phase_starts.size()) return;
+
+    while (changes.size() > phase_starts[k - log_from] + 1) {
+        auto& change = changes.back();
+        switch (change.type) {
+        case Change::Type::leaf:
+            erase_edge(change.node->id, change.ch);
+            break;
+        case Change::Type::split: {
+            // every later change below `internal` has been undone already,
+            // so it has exactly two children: the node below it and the leaf added by the split
+            // (the text has changed since, so their first characters come from the log)
+            auto internal = change.internal;
+            erase_edge(internal->id, (char)(change.c >> 8));
+            erase_edge(internal->id, (char)(change.c & 0xff));
+            if (change.is_leaf) {
+                *find_edge(change.node, change.ch) = Child::leaf(change.b);
+            }
+            else {
+                change.child->start = change.a;
+                *find_edge(change.node, change.ch) = Child::internal(change.child);
+            }
+            // the nodes are created and destroyed in reverse order, so it is the last one
+            assert(internal == by_id.back());
+            by_id.pop_back();
+            pool.destroy(internal);
+            break;
+        }
+        case Change::Type::suffix_link:
+            change.node->suffix_link = change.child;
+            break;
+        case Change::Type::weiner_link:
+            building_links[change.node->id].pop_back();
+            break;
+        case Change::Type::phase:
+            // the marker of a later phase, nothing to undo
+            break;
+        }
+        changes.pop_back();
+    }
+
+    // restore the state at the start of the k-th phase
+    auto& phase = changes.back();
+    active_node = phase.node;
+    active_edge = phase.a;
+    active_length = phase.b;
+    remainder = phase.c;
+    need_link = nullptr;
+    global_end = k;
+    changes.pop_back();
+    phase_starts.resize(k - log_from);
+}
+
+void SuffixTree::apply_edits(const std::vector<Edit>& edits) {
+    if (!editable) {
+        throw std::logic_error("SuffixTree::apply_edits: the tree was not constructed as editable");
+    }
+    if (edits.empty()) return;
+
+    // the batch is applied to a copy, so that a bad position leaves the text and the tree as they were
+    std::string edited(txt);
+    // the text before the leftmost edited position is left untouched by the whole batch
+    index_t from = (index_t)edited.size();
+    for (const auto& edit : edits) {
+        switch (edit.type) {
+        case Edit::Type::insert:
+            if (edit.pos > edited.size()) throw std::out_of_range("SuffixTree::apply_edits: bad position");
+            edited.insert(edited.begin() + edit.pos, edit.c);
+            break;
+        case Edit::Type::erase:
+            if (edit.pos >= edited.size()) throw std::out_of_range("SuffixTree::apply_edits: bad position");
+            edited.erase(edited.begin() + edit.pos);
+            break;
+        case Edit::Type::substitute:
+            if (edit.pos >= edited.size()) throw std::out_of_range("SuffixTree::apply_edits: bad position");
+            edited[edit.pos] = edit.c;
+            break;
+        }
+        from = std::min(from, edit.pos);
+    }
+    check_length(edited.size(), "SuffixTree");
+
+    if (from < log_from) {
+        buffer.swap(edited);
+        txt = buffer;
+        clear();
+        build();
+        return;
+    }
+
+    if (frozen) thaw();
+    else drop_lazy_weiner_links();
+    buffer.swap(edited);
+    txt = buffer;
+    for (const auto& edit : edits) {
+        if (edit.type != Edit::Type::erase) add_to_alphabet({&edit.c, 1});
+    }
+
+    rollback(from);
+    for (index_t k = from; k < txt.size(); k++) {
+        extend(k);
+    }
+    // (the window follows the end of the text, dropping its oldest phases once it has drifted by half its length)
+    auto start = window_start((index_t)txt.size());
+    if (start > log_from && start - log_from >= edit_window / 2) trim_log(start);
+}
+
+void SuffixTree::insert(index_t pos, char c) {
+    apply_edits({{Edit::Type::insert, pos, c}});
+}
+
+void SuffixTree::erase(index_t pos) {
+    apply_edits({{Edit::Type::erase, pos, '\0'}});
+}
+
+void SuffixTree::substitute(index_t pos, char c) {
+    apply_edits({{Edit::Type::substitute, pos, c}});
+}
+
+
+
+
+// ==========================================================================================
+//                              frozen weiner links and edges
+// ==========================================================================================
+
+/*
+once the tree is built, its weiner links never change (unless the text is edited),
+so they are moved from one small vector per node (building_links) into a single pair of CSR arrays,
+indexed by the ids of the internal nodes and sized exactly from a first count of the links:
+single_nf then reads the links of a node from one contiguous range, and the vectors are released
+
+likewise its edges: no insertion is needed anymore, so the edge table is replaced by a double array
+(see DoubleArray), where every step of a lookup reads the child's slot directly instead of probing
+(dense edges are left as they are, their lookups are a single read already)
+*/
+
+void SuffixTree::freeze() {
+    if (frozen) return;
+    frozen = true;
+    if (!dense) {
+        frozen_edges = DoubleArray<index_t, Child>(edges, by_id.size());
+        edges = EdgeTable<Child>(memory);
+    }
+    if (lazy_weiner_links) {
+        if (weiner_offsets.empty()) reverse_suffix_links();
+        return;
+    }
+    weiner_offsets.resize(by_id.size() + 1);
+    weiner_offsets[0] = 0;
+    for (size_t v = 0; v < by_id.size(); v++) {
+        weiner_offsets[v + 1] = weiner_offsets[v] + (index_t)building_links[v].size();
+    }
+    weiner_targets.resize(weiner_offsets.back());
+    for (size_t v = 0; v < by_id.size(); v++) {
+        std::copy(building_links[v].begin(), building_links[v].end(), weiner_targets.begin() + weiner_offsets[v]);
+    }
+    std::vector<std::vector<InternalNode*>>().swap(building_links);
+}
+
+/*
+without weiner links maintained during the construction, the CSR arrays are filled from the suffix links instead
+(by the first single_nf, or by freeze):
+count the nodes linking to each node, take prefix sums for the ends of their ranges,
+then place each node (the last first) just before the end of its suffix link's range, which ends at its start
+(the arrays are cleared rather than released by reset, so that the first single_nf on the next text allocates nothing)
+*/
+void SuffixTree::reverse_suffix_links() {
+    weiner_offsets.assign(by_id.size() + 1, 0);
+    for (auto node : by_id) {
+        if (node->suffix_link != nullptr) weiner_offsets[node->suffix_link->id]++;
+    }
+    for (size_t v = 1; v <= by_id.size(); v++) {
+        weiner_offsets[v] += weiner_offsets[v - 1];
+    }
+    weiner_targets.resize(weiner_offsets.back());
+    for (auto node = by_id.rbegin(); node != by_id.rend(); node++) {
+        if ((*node)->suffix_link != nullptr) weiner_targets[--weiner_offsets[(*node)->suffix_link->id]] = *node;
+    }
+}
+
+// (lazy weiner links are indexed by the ids of the nodes, so they are dropped whenever the nodes change,
+//  and the next single_nf derives them again)
+void SuffixTree::drop_lazy_weiner_links() {
+    std::vector<index_t>().swap(weiner_offsets);
+    std::vector<InternalNode*>().swap(weiner_targets);
+}
+
+void SuffixTree::thaw() {
+    if (!lazy_weiner_links) {
+        building_links.resize(by_id.size());
+        for (auto node : by_id) {
+            auto links = weiner_links_of(node);
+            building_links[node->id].assign(links.begin(), links.end());
+        }
+    }
+    if (!dense) {
+        edges.reserve(frozen_edges.size());
+        frozen_edges.for_each([this](uint64_t id, char c, Child next) {
+            edges.insert(id, c, next);
+        });
+        frozen_edges = {};
+    }
+    frozen = false;
+    drop_lazy_weiner_links();
+}
+
+std::span<SuffixTree::InternalNode* const> SuffixTree::weiner_links_of(const InternalNode* node) const {
+    if (!frozen && !lazy_weiner_links) return building_links[node->id];
+    return {weiner_targets.data() + weiner_offsets[node->id], weiner_targets.data() + weiner_offsets[node->id + 1]};
+}
+
+
+
+
+// ==========================================================================================
+//                                      node layout
+// ==========================================================================================
+
+/*
+Ukkonen's algorithm allocates the nodes in the order of their creation, which scatters a parent, its children
+and its suffix link over the pool: once the tree outgrows the cache, nearly every step of a lookup or a traversal misses
+ - relayout copies the nodes (other than the root) into one chunk of a fresh pool in preorder, and renumbers them in that order,
+   the edges being rebuilt under the new ids;
+ - every pointer (children, suffix links, weiner links, the active point) is then redirected through the preorder
+   number of its old target, and only after that are the old nodes freed (so the tree briefly exists twice)
+a frozen tree is thawed first and frozen again afterwards, as its CSR arrays are indexed by the old ids
+*/
+void SuffixTree::relayout() {
+    if (editable) {
+        throw std::logic_error("SuffixTree::relayout: an editable tree keeps its nodes in place");
+    }
+    auto was_frozen = frozen;
+    if (frozen) thaw();
+    else drop_lazy_weiner_links();
+
+    // preorder[id] = the preorder number of the node with that id
+    std::vector<InternalNode*> nodes;
+    std::vector<index_t> preorder(by_id.size());
+    std::vector<InternalNode*> stack{root.get()};
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        preorder[node->id] = (index_t)nodes.size();
+        nodes.push_back(node);
+        auto below = children(node);
+        for (auto child = below.rbegin(); child != below.rend(); child++) {
+            if (!child->second.is_leaf()) stack.push_back(child->second.node());
+        }
+    }
+
+    Pool<InternalNode> relaid(memory);
+    relaid.reserve(nodes.size() - 1);
+    std::vector<InternalNode*> copies{root.get()};
+    for (size_t v = 1; v < nodes.size(); v++) {
+        copies.push_back(relaid.create(*nodes[v]));
+    }
+    auto relocate = [&copies, &preorder](InternalNode* node) {
+        return node == nullptr ? node : copies[preorder[node->id]];
+    };
+    // (dense edges are redone in place of the edge table, see below)
+    EdgeTable<Child> relaid_edges(memory);
+    DenseEdges<Child> relaid_dense_edges(alphabet);
+    if (dense) relaid_dense_edges.reserve(nodes.size());
+    else relaid_edges.reserve(edges.size());
+    for_each_edge([&](uint64_t id, char c, Child child) {
+        if (!child.is_leaf()) child = Child::internal(relocate(child.node()));
+        if (dense) relaid_dense_edges.insert(preorder[id], c, child);
+        else relaid_edges.insert(preorder[id], c, child);
+    });
+    for (auto copy : copies) {
+        copy->suffix_link = relocate(copy->suffix_link);
+    }
+    // (the weiner links move with the ids of their nodes)
+    if (!lazy_weiner_links) {
+        std::vector<std::vector<InternalNode*>> relaid_links(building_links.size());
+        for (size_t v = 0; v < nodes.size(); v++) {
+            relaid_links[v] = std::move(building_links[nodes[v]->id]);
+            for (auto& link : relaid_links[v]) link = relocate(link);
+        }
+        building_links = std::move(relaid_links);
+    }
+    active_node = relocate(active_node);
+    need_link = relocate(need_link);
+    for (size_t v = 0; v < copies.size(); v++) {
+        copies[v]->id = (index_t)v;
+    }
+
+    // (the old pool, with the old nodes, goes with `relaid`, and the old table with `relaid_edges`)
+    std::vector<InternalNode*>().swap(spare_nodes);
+    pool = std::move(relaid);
+    edges = std::move(relaid_edges);
+    dense_edges = std::move(relaid_dense_edges);
+    by_id = std::move(copies);
+    if (was_frozen) freeze();
+}
+
+
+
 // ==========================================================================================
 //                                  other functions
 // ==========================================================================================
 
 
-// internal node destructor
-SuffixTree::InternalNode::~InternalNode() {
-    for (auto& [_, child] : internal_children) {
-        delete child;
+// a node from the pool, numbered after the last one
+// (or a spare one, while the weiner links of its id keep their capacity)
+SuffixTree::InternalNode* SuffixTree::new_node(index_t i, index_t j, index_t d) {
+    InternalNode* node;
+    if (spare_nodes.empty()) {
+        node = pool.create(i, j, d);
     }
-    for (auto& [_, child] : leaf_children) {
-        delete child;
+    else {
+        node = spare_nodes.back();
+        spare_nodes.pop_back();
+        node->start = i;
+        node->end = j;
+        node->depth = d;
+        node->suffix_link = nullptr;
+        node->nf = 0;
     }
+    node->id = (index_t)by_id.size();
+    by_id.push_back(node);
+    if (!lazy_weiner_links && building_links.size() < by_id.size()) building_links.emplace_back();
+    return node;
+}
+
+// the edges of a node, wherever they are kept (not for frozen trees)
+SuffixTree::Child* SuffixTree::find_edge(const InternalNode* node, char c) {
+    return dense ? dense_edges.find(node->id, c) : edges.find(node->id, c);
+}
+
+// (a new edge: the lookup in extend() that found it missing is not repeated)
+void SuffixTree::insert_edge(index_t id, char c, Child child) {
+    if (dense) dense_edges.insert(id, c, child);
+    else edges.insert(id, c, child);
+}
+
+void SuffixTree::erase_edge(index_t id, char c) {
+    if (dense) dense_edges.erase(id, c);
+    else edges.erase(id, c);
+}
+
+// (the alphabet only grows, a character that no longer occurs in the text costs a lookup now and then)
+//
+// the representation of the edges is chosen from the size of the alphabet: the dense arrays are indexed by the ranks
+// of the characters, so they are rebuilt whenever the alphabet grows (when an edit brings in a new character),
+// and the edges move to the edge table for good once it has more than `dense_sigma` characters
+void SuffixTree::add_to_alphabet(std::string_view s) {
+    bool seen[256] = {};
+    for (auto c : alphabet) seen[(unsigned char)c] = true;
+    for (auto c : s) seen[(unsigned char)c] = true;
+    auto sigma = alphabet.size();
+    alphabet.clear();
+    for (int c = std::numeric_limits<char>::min(); c <= std::numeric_limits<char>::max(); c++) {
+        if (seen[(unsigned char)c]) alphabet.push_back((char)c);
+    }
+    if (alphabet.size() == sigma) return;
+
+    auto was_dense = dense;
+    dense = alphabet.size() <= dense_sigma;
+    if (!was_dense) return;
+    // (a table with no edges yet, at the start of a construction, keeps its memory)
+    DenseEdges<Child> old_edges;
+    if (dense_edges.size() > 0) std::swap(old_edges, dense_edges);
+    dense_edges.reset(dense ? alphabet : std::string_view{});
+    if (dense) dense_edges.reserve(by_id.size());
+    else edges.reserve(old_edges.size());
+    old_edges.for_each([this](uint64_t id, char c, Child child) {
+        insert_edge((index_t)id, c, child);
+    });
+}
+
+// (the arrays pay for sigma slots per node whatever its number of children, the table for 1.1 to 2.3 slots
+//  of twice the size per edge)
+void SuffixTree::fit_edges() {
+    if (!dense || dense_edges.size_in_bytes() <= EdgeTable<Child>::bytes_for(dense_edges.size())) return;
+    dense = false;
+    edges.reserve(dense_edges.size());
+    dense_edges.for_each([this](uint64_t id, char c, Child child) {
+        edges.insert(id, c, child);
+    });
+    dense_edges = DenseEdges<Child>();
 }
 
 // suffix tree constructor
-SuffixTree::SuffixTree(std::string_view _txt) :
+SuffixTree::SuffixTree(std::string_view _txt, Options options) :
     txt(_txt),
-    root(std::make_unique<InternalNode>(0, 0)),
+    memory(options.memory),
+    pool(options.memory),
+    edges(options.memory),
+    dense(true),
+    dense_sigma(options.dense_sigma),
+    depth_bound(std::numeric_limits<index_t>::max()),
+    sparse(false),
+    root(std::make_unique<InternalNode>(0, 0, 0)),
     need_link(nullptr),
     global_end(0),
     remainder(0),
     active_node(root.get()),
     active_edge(0),
-    active_length(0) {
-    for (uint32_t k = 0; k < txt.size(); k++) {
+    active_length(0),
+    editable(options.editable),
+    edit_window(options.edit_window),
+    log_from(0),
+    logging(false),
+    frozen(false),
+    lazy_weiner_links(!options.eager_weiner_links) {
+    build();
+}
+
+void SuffixTree::build() {
+    check_length(txt.size(), "SuffixTree");
+    log_from = window_start((index_t)txt.size());
+    by_id.push_back(root.get());
+    if (!lazy_weiner_links && building_links.empty()) building_links.emplace_back();
+    add_to_alphabet(txt);
+    // n leaves and usually about n/2 internal nodes
+    if (dense) dense_edges.reserve(txt.size() / 2 + 1);
+    else edges.reserve(txt.size() + txt.size() / 2);
+    for (index_t k = 0; k < txt.size(); k++) {
         extend(k);
     }
+    fit_edges();
 }
 
-uint32_t SuffixTree::LeafNode::edge_length() {
-    return *end_ptr - start;
+/*
+the tree is emptied without releasing anything: the nodes (other than the root) become spares for new_node,
+the edge table and the dense arrays are cleared in place, and the other vectors keep their capacity,
+then the tree is built again as by the constructor
+*/
+void SuffixTree::reset(std::string_view _txt) {
+    if (!complete()) {
+        throw std::logic_error("SuffixTree::reset: a sparse or truncated tree is built top down");
+    }
+    // the new text may be (part of) the current one, owned by the buffer after an edit
+    std::less<const char*> before;
+    if (!buffer.empty() && !before(_txt.data(), buffer.data()) && before(_txt.data(), buffer.data() + buffer.size())) {
+        buffer = std::string(_txt);
+        txt = buffer;
+    }
+    else {
+        txt = _txt;
+        buffer.clear();
+    }
+    clear();
+    build();
+}
+
+void SuffixTree::clear() {
+    // (spares left over from an earlier text stay behind the new ones)
+    spare_nodes.insert(spare_nodes.end(), by_id.rbegin(), by_id.rend() - 1);
+    by_id.clear();
+    root->suffix_link = nullptr;
+    root->nf = 0;
+    for (auto& links : building_links) links.clear();
+    edges.clear();
+    dense_edges.reset({});
+    dense = true;
+    alphabet.clear();
+
+    need_link = nullptr;
+    global_end = 0;
+    remainder = 0;
+    active_node = root.get();
+    active_edge = 0;
+    active_length = 0;
+    changes.clear();
+    phase_starts.clear();
+
+    if (frozen) {
+        frozen = false;
+        frozen_edges = {};
+    }
+    weiner_offsets.clear();
+    weiner_targets.clear();
 }
 
-uint32_t SuffixTree::InternalNode::edge_length() {
-    return end - start;
+// parallel suffix tree constructor
+SuffixTree::SuffixTree(std::string_view _txt, Parallel parallel, Options options) :
+    SuffixTree(_txt, parallel, options, std::numeric_limits<index_t>::max(), std::nullopt) {}
+
+// the partitioning of a truncated or sparse construction: by the first two characters when it is built in parallel,
+// none otherwise (every partition has a pool of its own)
+static SuffixTree::Parallel partitioned(unsigned threads) {
+    return {threads, threads == 1 ? std::numeric_limits<uint32_t>::max() : 2};
 }
+
+// truncated suffix tree constructor: the nodes of depth max_length + 1 still need their children,
+// for the leaves below the left extensions xS of the strings S of length max_length
+SuffixTree::SuffixTree(std::string_view _txt, Truncated truncated, Options options) :
+    SuffixTree(_txt, partitioned(truncated.threads), options, truncated.max_length + 2, std::nullopt) {}
+
+// sparse suffix tree constructor
+SuffixTree::SuffixTree(std::string_view _txt, Sparse _sparse, Options options) :
+    SuffixTree(_txt, partitioned(_sparse.threads), options, std::numeric_limits<index_t>::max(), _sparse.positions) {}
+
+SuffixTree::SuffixTree(std::string_view _txt, Parallel parallel, Options options, index_t bound,
+                       std::optional<std::span<const index_t>> positions) :
+    txt(_txt),
+    memory(options.memory),
+    pool(options.memory),
+    edges(options.memory),
+    dense(true),
+    dense_sigma(options.dense_sigma),
+    depth_bound(bound),
+    sparse(positions.has_value()),
+    root(std::make_unique<InternalNode>(0, 0, 0)),
+    need_link(nullptr),
+    global_end((index_t)_txt.size()),
+    remainder(0),
+    active_node(root.get()),
+    active_edge(0),
+    active_length(0),
+    editable(false),
+    edit_window(options.edit_window),
+    log_from(0),
+    logging(false),
+    frozen(false),
+    lazy_weiner_links(!options.eager_weiner_links) {
+    check_length(txt.size(), "SuffixTree");
+    if (options.editable) {
+        throw std::logic_error("SuffixTree: a tree built top down cannot be editable");
+    }
+    if (!txt.empty() && std::count(txt.begin(), txt.end(), txt.back()) != 1) {
+        throw std::invalid_argument("SuffixTree: the text must end with a unique terminator");
+    }
+    by_id.push_back(root.get());
+    add_to_alphabet(txt);
+
+    auto n = (index_t)txt.size();
+    // (a sparse tree only ever holds its positions, whatever the length of the text)
+    std::vector<index_t> suffixes;
+    if (sparse) {
+        for (size_t r = 0; r < positions->size(); r++) {
+            if ((*positions)[r] >= n || (r > 0 && (*positions)[r] <= (*positions)[r - 1])) {
+                throw std::invalid_argument("SuffixTree: the sparse positions must be increasing and within the text");
+            }
+        }
+        sparse_positions.assign(positions->begin(), positions->end());
+        suffixes = sparse_positions;
+    }
+    else {
+        suffixes.resize(n);
+        std::iota(suffixes.begin(), suffixes.end(), 0);
+    }
+
+    // the top of the tree, then the partitions in parallel (largest first)
+    std::vector<Group> groups;
+    std::vector<Edge> top_edges;
+    build_top_down(pool, top_edges, suffixes.data(), root.get(), 0, 0, (index_t)suffixes.size(), std::max(parallel.prefix_len, 1u), &groups);
+    std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+        return a.hi - a.lo > b.hi - b.lo;
+    });
+    // one pool per group, so that each thread allocates (and first touches) the nodes of its own subtrees
+    std::vector<Pool<InternalNode>> pools;
+    for (size_t g = 0; g < groups.size(); g++) {
+        pools.emplace_back(memory);
+    }
+    std::vector<std::vector<Edge>> group_edges(groups.size());
+    parallel_for(groups.size(), parallel.threads, [&](size_t g) {
+        auto& [parent, depth, lo, hi, node] = groups[g];
+        auto node_depth = extension(suffixes.data(), lo, hi, depth + 1, depth_bound);
+        node = pools[g].create(suffixes[lo] + depth, suffixes[lo] + node_depth, node_depth);
+        build_top_down(pools[g], group_edges[g], suffixes.data(), node, node_depth, lo, hi, std::numeric_limits<index_t>::max(), nullptr);
+    });
+    for (auto& nodes : pools) {
+        pool.adopt(std::move(nodes));
+    }
+    for (auto& group : groups) {
+        top_edges.push_back({group.parent, txt[group.node->start], Child::internal(group.node)});
+    }
+
+    // number the nodes (the root has id 0), then fill the edge table
+    group_edges.push_back(std::move(top_edges));
+    size_t edge_count = 0;
+    for (auto& out : group_edges) {
+        edge_count += out.size();
+        for (auto& edge : out) {
+            if (edge.child.is_leaf()) continue;
+            edge.child.node()->id = (index_t)by_id.size();
+            by_id.push_back(edge.child.node());
+        }
+    }
+    if (dense && by_id.size() * alphabet.size() * sizeof(Child) > EdgeTable<Child>::bytes_for(edge_count)) {
+        dense = false;
+        dense_edges.reset({});
+    }
+    if (dense) dense_edges.reserve(by_id.size());
+    else edges.reserve(edge_count);
+    for (auto& out : group_edges) {
+        for (auto& edge : out) {
+            insert_edge(edge.parent->id, edge.c, edge.child);
+        }
+        std::vector<Edge>().swap(out);
+    }
+
+    // the depths of the parents of the leaves, in place of the suffix links
+    // (the suffix of a string at a sampled position does not start at one in general)
+    if (sparse) {
+        sparse_depths.resize(sparse_positions.size());
+        for_each_edge([this](uint64_t id, char, Child child) {
+            if (!child.is_leaf()) return;
+            auto r = std::lower_bound(sparse_positions.begin(), sparse_positions.end(), child.suffix()) - sparse_positions.begin();
+            sparse_depths[(size_t)r] = by_id[id]->depth;
+        });
+        return;
+    }
+
+    // suffix links, one task per child of the root
+    std::vector<InternalNode*> tops;
+    for (auto& [_, child] : children(root.get())) {
+        if (child.is_leaf() || child.node()->depth >= depth_bound) continue;
+        auto node = child.node();
+        node->suffix_link = walk_down(root.get(), node->start + 1, node->end);
+        tops.push_back(node);
+    }
+    parallel_for(tops.size(), parallel.threads, [&](size_t t) {
+        add_suffix_links(tops[t]);
+    });
+
+    // weiner links
+    if (lazy_weiner_links) return;
+    building_links.resize(by_id.size());
+    for (size_t v = 1; v < by_id.size(); v++) {
+        if (by_id[v]->suffix_link != nullptr) building_links[by_id[v]->suffix_link->id].push_back(by_id[v]);
+    }
+}
+
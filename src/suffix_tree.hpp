@@ -1,65 +1,181 @@
 #pragma once
 
-#include <unordered_map>
 #include <string_view>
 #include <memory> // std::unique_ptr
 #include <vector>
 #include <utility> // std::pair
 #include <set>
+#include <string>
+#include <span>
+#include <optional>
+#include <algorithm> // std::min
+#include <cstdint>
+
+#include "./index.hpp"
+#include "./memory.hpp"
+#include "./edge_table.hpp"
+#include "./double_array.hpp"
+#include "./dense_edges.hpp"
 
 
 class SuffixTree {
 public:
-    // an abstract node class as the base class for LeafNode and InternalNode,
-    // each node includes the node and the edge leading to the node,
+    // an internal node, including the edge leading to the node,
     // the string label for the edge is represented as 
     // a pair of indices [start, end] of the input text
     // (note that the length of an edge is computed as end-start rather than 
     //  end-start+1 because `end` is the actual end index plus one)
-    class Node {
+    //
+    // the children of all nodes are kept in the tree's edge table or dense arrays (see Child),
+    // leaves are implicit: a leaf child is only the starting position of its suffix,
+    // its edge label being txt[suffix + depth ... global_end) where `depth` is the string depth of the parent
+    class InternalNode {
     public:
-        uint32_t start;
-        virtual uint32_t edge_length() = 0;
-        // ("= 0" for pure virtual function) 
-        Node(uint32_t i): start(i) {}
+        index_t start;
+        index_t end;
+        // the string depth of the node (the length of its path label)
+        index_t depth;
+        index_t edge_length() const { return end - start; }
+
+        InternalNode* suffix_link;
+
+        // net frequency value stored at each internal node
+        index_t nf;
+
+        // the number of the node in the order of creation (the root being 0),
+        // its key in the edge table and its index in the tree's `by_id`
+        index_t id;
+
+        // (the children are released with the tree's pool)
+        InternalNode(index_t i, index_t j, index_t d): 
+            start(i), end(j), depth(d),
+            suffix_link(nullptr),
+            nf(0), id(0) {}
     };
 
-    class LeafNode : public Node {
-    public:
-        // use a pointer for fast leaf end index updates
-        // (see `global_end`, a private field in SuffixTree below)
-        uint32_t* end_ptr;
-        uint32_t edge_length() override; 
-        LeafNode(uint32_t i, uint32_t* j): Node(i), end_ptr(j) {}
-        virtual ~LeafNode() {};
+    // the value of an edge in the edge table: an internal node, or the suffix of a leaf,
+    // told apart by the lowest bit (nodes are aligned, a leaf is stored as 2 * suffix + 1)
+    struct Child {
+        uint64_t bits;
+
+        static Child leaf(index_t suffix) { return {(uint64_t)suffix << 1 | 1}; }
+        static Child internal(InternalNode* node) { return {reinterpret_cast<uintptr_t>(node)}; }
+        bool is_leaf() const { return bits & 1; }
+        // no edge at all (an empty slot of DenseEdges)
+        bool empty() const { return bits == 0; }
+        index_t suffix() const { return (index_t)(bits >> 1); }
+        InternalNode* node() const { return reinterpret_cast<InternalNode*>(bits); }
     };
 
-    class InternalNode : public Node {
-    public:
-        uint32_t end;
-        uint32_t edge_length() override;
-    
-        // split the child nodes into internal and leaf nodes
-        std::unordered_map<char, InternalNode*> internal_children;
-        std::unordered_map<char, LeafNode*> leaf_children;
-    
-        InternalNode* suffix_link;
-        // use vector instead of set for faster traversal (at the cost of slower construction)
-        std::vector<InternalNode*> weiner_links;
+    // a single-character edit of the text, positions refer to the text as it is
+    // when the edit is applied (i.e., after all earlier edits of the same batch)
+    struct Edit {
+        enum class Type { insert, erase, substitute };
+        Type type;
+        index_t pos;
+        char c; // unused for erase
+    };
 
-        // net frequency value stored at each internal node
-        uint32_t nf;
+    // the auxiliary structures maintained by the tree, chosen at construction to suit the job
+    // (the edges and suffix links are always built: Ukkonen's algorithm relies on them)
+    struct Options {
+        // support `apply_edits`, recording the changes made by the phases of the last `edit_window` characters
+        // (at most half the text): an edit within them is repaired, one before them rebuilds the tree
+        // (the log takes about 200 bytes per character of the window, e.g. 13 MB for the default one)
+        bool editable = false;
+        // maintain the weiner links during the construction, otherwise they are derived from the suffix links
+        // by the first single_nf (or freeze), so that a tree only used for all_nf or lookups never builds them
+        // (the edges are only ever moved into a double array by an explicit freeze)
+        bool eager_weiner_links = true;
+        // how the memory of the nodes is backed
+        MemoryPolicy memory = {};
+        // the children are kept in dense arrays (sigma slots per node, indexed by the rank of the character)
+        // while the text has at most this many distinct characters, and in the edge table otherwise;
+        // once the tree is built, the arrays are only kept if they take no more memory than the table would
+        // (on random texts of 1M characters, bench_nf alphabet: up to sigma = 4 to 6, where the tree takes 0.8 times
+        //  the memory; beyond, the arrays would only raise the peak of the construction, up to 2 times at sigma = 28)
+        unsigned dense_sigma = 8;
+        // see editable
+        index_t edit_window = (index_t)1 << 16;
+
+        // the profiles of the usual jobs (for_all_nf also suits a tree only used for lookups or traversals,
+        // as nothing but the weiner links can be left out)
+        static Options for_all_nf() { return {false, false}; }
+        static Options for_single_nf() { return {false, true}; }
+        static Options for_edits() { return {true, true}; }
+    };
+
+    // options of the parallel (top-down) construction:
+    // suffixes are partitioned by their first `prefix_len` characters and
+    // each partition's subtree is built independently on one of `threads` threads (0 = all cores)
+    struct Parallel {
+        unsigned threads;
+        uint32_t prefix_len;
+    };
+
+    // options of the truncated (top-down) construction, for jobs that only need the NF of strings of at most
+    // `max_length` characters: no node deeper than max_length + 1 is expanded, the suffixes that still agree there
+    // are merged into a childless node of string depth max_length + 2 (a repeat, standing for all of them),
+    // so long repeats cost one node each instead of a whole subtree
+    // (single_nf of longer strings throws, and lookups are only exact up to max_length + 1 characters)
+    struct Truncated {
+        index_t max_length;
+        // the number of threads of the construction, as in Parallel (0 = all cores)
+        unsigned threads = 1;
+    };
 
-        InternalNode(uint32_t i, uint32_t j): 
-            Node(i), end(j), 
-            suffix_link(nullptr), weiner_links({}),
-            nf(0) {}
-        virtual ~InternalNode();
+    // options of the sparse (top-down) construction: only the suffixes starting at `positions` (increasing,
+    // e.g. the starts of the words) are indexed, so the tree has at most 2 * positions.size() nodes;
+    // the NF then only counts the occurrences at those positions, the left extension of an occurrence
+    // reaching back to the previous position (so that with every position of the text, it is the usual NF)
+    struct Sparse {
+        std::span<const index_t> positions;
+        // the number of threads of the construction, as in Parallel (0 = all cores)
+        unsigned threads = 1;
     };
 
 private:
     // the input text
     std::string_view txt;
+    // owned copy of the text, only populated once the text is edited
+    std::string buffer;
+
+    // every node other than the root is allocated from the pool
+    MemoryPolicy memory;
+    Pool<InternalNode> pool;
+    // by_id[v] = the node with id v
+    std::vector<InternalNode*> by_id;
+    InternalNode* new_node(index_t i, index_t j, index_t d);
+    // the nodes of the previous text after a reset, taken again by new_node (the next one at the back)
+    std::vector<InternalNode*> spare_nodes;
+    // the weiner links of the node with id v while the tree is built with eager weiner links (and not frozen),
+    // kept beside the nodes so that freeze leaves nothing of them in the nodes
+    // (use vector instead of set for faster traversal, at the cost of slower construction)
+    std::vector<std::vector<InternalNode*>> building_links;
+
+    // the edges of all nodes, keyed by (id of the parent, first character),
+    // in `dense_edges` instead while the alphabet has at most `dense_sigma` characters
+    // (and, once the tree is built, only if they take no more memory than the edge table would, see fit_edges)
+    EdgeTable<Child> edges;
+    DenseEdges<Child> dense_edges;
+    bool dense;
+    unsigned dense_sigma;
+    Child* find_edge(const InternalNode* node, char c);
+    void insert_edge(index_t id, char c, Child child);
+    void erase_edge(index_t id, char c);
+    // move the edges into the edge table for good if the dense arrays take more memory than it would
+    void fit_edges();
+    // the distinct characters of the text (or of any earlier version of it), in order
+    std::string alphabet;
+    void add_to_alphabet(std::string_view s);
+    // the string depth of the childless nodes of a truncated tree (see Truncated), the largest index_t otherwise
+    index_t depth_bound;
+    // the positions indexed by a sparse tree (see Sparse), and sparse_depths[r] = the string depth of the parent
+    // of the leaf of sparse_positions[r] (a sparse tree has neither suffix links nor weiner links)
+    bool sparse;
+    std::vector<index_t> sparse_positions;
+    std::vector<index_t> sparse_depths;
+    bool left_unique(index_t p, index_t depth) const;
 
 public:
     // todo: write an internal node iterator
@@ -72,31 +188,167 @@ private:
     // in each phase, a pointer to the node that needs a suffix link
     InternalNode* need_link;
     // used to update `end` for the leaf nodes ("once a leaf, always a leaf")
-    uint32_t global_end;
+    index_t global_end;
     // in each phase, remainder = the number of suffixes that need to be inserted explicitly:
     //      i.e., suffixes remaining from previous phases and txt[k] from the k-th (current) phase,
     //      i.e., suffixes that are not automatically updated by global_end
-    uint32_t remainder;
+    index_t remainder;
     // active point: specified by a triple (active_node, active_edge, active_length)
     // indicating from where we start inserting a new suffix (the start of next phase/extension)
-    // (note that a LeafNode or InternalNode contains the edge leading to the node,
+    // (note that a node (or an implicit leaf) comes with the edge leading to it,
     //  but active_edge is an outgoing edge of active_node)
     InternalNode* active_node;
-    uint32_t active_edge; // the corresponding character is txt[active_edge]
-    uint32_t active_length;
+    index_t active_edge; // the corresponding character is txt[active_edge]
+    index_t active_length;
 
-    void extend(uint32_t k);
+    void extend(index_t k);
     void add_links(InternalNode* node);
+    // run the algorithm over the whole text, from a tree with only the root
+    void build();
+    // empty the tree, keeping the nodes as spares and every buffer's capacity (see reset)
+    void clear();
     // ------------------------------------------------------------------------------------------------
 
+    // ------------------------ the following are used in the parallel construction ------------------------
+
+    // a group of suffixes (suffixes[lo...hi-1]) below `parent` that is built as an independent task,
+    // `depth` is the string depth of `parent` and `node` is the root of the finished subtree
+    struct Group {
+        InternalNode* parent;
+        index_t depth;
+        index_t lo, hi;
+        InternalNode* node;
+    };
+    // the nodes of a task are numbered and its edges inserted into the table once all tasks are done
+    struct Edge {
+        InternalNode* parent;
+        char c;
+        Child child;
+    };
+    index_t extension(const index_t* suffixes, index_t lo, index_t hi, index_t depth, index_t cap);
+    void build_top_down(Pool<InternalNode>& nodes, std::vector<Edge>& out, index_t* suffixes, InternalNode* node, index_t depth,
+                        index_t lo, index_t hi, index_t defer_depth, std::vector<Group>* deferred);
+    InternalNode* walk_down(InternalNode* node, index_t i, index_t j);
+    void add_suffix_links(InternalNode* node);
+    // the parallel construction, with no node expanded below string depth `bound` (see Truncated),
+    // of the suffixes starting at `positions` (see Sparse), or at every position of the text
+    SuffixTree(std::string_view _txt, Parallel parallel, Options options, index_t bound,
+               std::optional<std::span<const index_t>> positions);
+    // --------------------------------------------------------------------------------------------------------
+
+    // ------------------------ the following are used for dynamic edits ------------------------
+
+    // every change made to the tree by extend() in the phases from `log_from` on is recorded (if the tree is editable),
+    // so that the tree can be rolled back to the end of any of these phases
+    struct Change {
+        enum class Type { phase, leaf, split, suffix_link, weiner_link };
+        Type type;
+        // phase: the active point and remainder at the start of the phase
+        // leaf: the parent and the character of the new leaf
+        // split: the parent, the character of the split edge, the new internal node,
+        //        and the node below it (an internal node in `child` and its original start in `a`,
+        //        or the suffix of a leaf in `b`), and the first characters of the two edges below
+        //        the new node in `c` (the new leaf's in the second byte, the other one's in the first)
+        // suffix_link: the node and its previous suffix link (in `child`)
+        // weiner_link: the node that had a weiner link appended
+        InternalNode* node;
+        InternalNode* internal;
+        InternalNode* child;
+        index_t a, b, c; // phase: active_edge, active_length, remainder
+        char ch;
+        bool is_leaf;
+    };
+    bool editable;
+    index_t edit_window;
+    index_t log_from;
+    // whether the current phase is recorded
+    bool logging;
+    std::vector<Change> changes;
+    // phase_starts[k - log_from] = the index in `changes` of the phase marker of the k-th phase
+    std::vector<size_t> phase_starts;
+    void log(Change change);
+    // the first phase to record for a text of n characters
+    index_t window_start(index_t n) const { return n - std::min(edit_window, n / 2); }
+    // forget the changes of the phases before k (k >= log_from)
+    void trim_log(index_t k);
+    // undo every change made from the start of phase k onwards (k >= log_from)
+    void rollback(index_t k);
+    // --------------------------------------------------------------------------------------------
+
+    // ------------------------ the following are used once the tree is frozen ------------------------
+
+    // the weiner links of all nodes in compressed sparse row form (once frozen, or lazy weiner links once derived):
+    // the links of the node with id v are weiner_targets[weiner_offsets[v] ... weiner_offsets[v+1])
+    bool frozen;
+    // the edges, moved out of the (then empty) edge table into a double array
+    DoubleArray<index_t, Child> frozen_edges;
+    // the child of a node by its first character, from either
+    const Child* child(const InternalNode* node, char c) const;
+    template <typename F>
+    void for_each_edge(F f) const;
+    std::vector<index_t> weiner_offsets;
+    std::vector<InternalNode*> weiner_targets;
+    std::span<InternalNode* const> weiner_links_of(const InternalNode* node) const;
+    // see Options::eager_weiner_links
+    bool lazy_weiner_links;
+    void reverse_suffix_links();
+    // move the weiner links back into building_links (before the tree is modified again)
+    void thaw();
+    // forget the CSR arrays of lazy weiner links (before the nodes are modified or renumbered)
+    void drop_lazy_weiner_links();
+    // --------------------------------------------------------------------------------------------
+
 public:
-    // constructor
-    SuffixTree(std::string_view _txt);
+    // constructor, see Options
+    SuffixTree(std::string_view _txt, Options options);
+    SuffixTree(std::string_view _txt) : SuffixTree(_txt, Options{}) {}
+    // the top-down constructors (parallel, truncated and sparse): the text must end with a unique terminator,
+    // and the tree is not editable (throws std::invalid_argument otherwise, and std::logic_error for options.editable)
+    SuffixTree(std::string_view _txt, Parallel parallel, Options options);
+    SuffixTree(std::string_view _txt, Parallel parallel) : SuffixTree(_txt, parallel, Options{}) {}
+    SuffixTree(std::string_view _txt, Truncated truncated, Options options);
+    SuffixTree(std::string_view _txt, Truncated truncated) : SuffixTree(_txt, truncated, Options{}) {}
+    SuffixTree(std::string_view _txt, Sparse _sparse, Options options);
+    SuffixTree(std::string_view _txt, Sparse _sparse) : SuffixTree(_txt, _sparse, Options{}) {}
 
-    std::pair<InternalNode*, uint32_t> find_internal_node(std::string_view s);
+    std::pair<InternalNode*, index_t> find_internal_node(std::string_view s);
 
-    uint32_t single_nf(std::string_view s);
+    // the children of a node, by first character
+    std::vector<std::pair<char, Child>> children(const InternalNode* node) const;
+    // the number of internal nodes, the root included (the ids are 0 ... internal_nodes()-1)
+    size_t internal_nodes() const { return by_id.size(); }
+
+    // (with lazy weiner links, the first call derives them from the suffix links and so is not thread-safe:
+    //  make it, or call freeze, before querying from several threads; the later calls only read the tree)
+    index_t single_nf(std::string_view s);
 
     void all_nf();
 
+    // move all weiner links into two contiguous arrays and the edges (unless dense) into a double array once the tree is built,
+    // releasing the per-node vectors and the edge table (editing the tree later moves them back)
+    void freeze();
+
+    // copy the nodes into a single array in preorder once the tree is built (not for editable trees),
+    // so that lookups and traversals walk mostly forward through memory
+    void relayout();
+
+    // apply a batch of edits to the text and repair the tree: if the leftmost edited position lies within
+    // the edit window (see Options::editable), the phases from that position onwards are undone and redone,
+    // so the cost is that of rebuilding the text after it, otherwise the tree is rebuilt (reusing its memory as reset)
+    // (the text must still end with a unique terminator afterwards;
+    //  throws std::out_of_range for a bad position, leaving the text and the tree as they were)
+    void apply_edits(const std::vector<Edit>& edits);
+    void insert(index_t pos, char c);
+    void erase(index_t pos);
+    void substitute(index_t pos, char c);
+
+    // rebuild the tree on another text (with Ukkonen's algorithm and the same options), reusing the nodes,
+    // the edge arrays and every other buffer: once the texts stop growing, a rebuild allocates nothing
+    // (not for sparse or truncated trees; the new text may be a view of the tree's own, e.g. st.reset(st.text()))
+    void reset(std::string_view _txt);
+
+    std::string_view text() const { return txt; }
+    // whether the tree holds every suffix in full, i.e., it is neither sparse nor truncated
+    bool complete() const { return !sparse && depth_bound == std::numeric_limits<index_t>::max(); }
+
 };